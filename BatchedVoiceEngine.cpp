@@ -0,0 +1,226 @@
+#include "BatchedVoiceEngine.h"
+#include "PluginProcessor.h"
+
+namespace
+{
+    constexpr int L = BatchedVoiceEngine::numLanes;
+    constexpr float pi = juce::MathConstants<float>::pi;
+    constexpr float halfPi = juce::MathConstants<float>::halfPi;
+    constexpr float twoPi = juce::MathConstants<float>::twoPi;
+
+    // Branch-free helpers so the lane loops vectorise: selects are written as
+    // arithmetic blends on 0/1 masks. Errors stay below 2e-6 rad / 3e-7.
+
+    inline float mask(bool c) { return static_cast<float>(c); }
+
+    /** Wraps to [-pi, pi), matching the fmod-based wrap of the per-voice path. */
+    inline float wrapPhase(float x)
+    {
+        float t = (x + pi) * (1.0f / twoPi);
+        float k = static_cast<float>(static_cast<int>(t));
+        k -= mask(t < k);
+        return x - twoPi * k;
+    }
+
+    inline float fastAtan2(float y, float x)
+    {
+        float ax = std::abs(x), ay = std::abs(y);
+        float mx = juce::jmax(ax, ay), mn = juce::jmin(ax, ay);
+        float a = mn / (mx + 1.0e-30f);
+        float s = a * a;
+        float r = a * (0.99997726f + s * (-0.33262347f + s * (0.19354346f + s * (-0.11643287f + s * (0.05265332f + s * -0.01172120f)))));
+        r += mask(ay > ax) * (halfPi - 2.0f * r);
+        r += mask(x < 0.0f) * (pi - 2.0f * r);
+        return std::copysign(r, y);
+    }
+
+    /** sin(x) for x in [-pi/2, pi/2]. */
+    inline float sinQuadrant(float x)
+    {
+        float s = x * x;
+        return x * (1.0f + s * (-1.0f / 6.0f + s * (1.0f / 120.0f + s * (-1.0f / 5040.0f + s * (1.0f / 362880.0f + s * (-1.0f / 39916800.0f))))));
+    }
+
+    /** Folds x in [-pi, pi] into [-pi/2, pi/2] with the same sine. */
+    inline float foldQuadrant(float x)
+    {
+        return x + mask(x > halfPi) * (pi - 2.0f * x) + mask(x < -halfPi) * (-pi - 2.0f * x);
+    }
+
+    /** sin and cos for x in [-pi, pi]. */
+    inline void fastSinCos(float x, float& sn, float& cs)
+    {
+        float xc = x + halfPi;
+        xc -= mask(xc > pi) * twoPi;
+        sn = sinQuadrant(foldQuadrant(x));
+        cs = sinQuadrant(foldQuadrant(xc));
+    }
+}
+
+BatchedVoiceEngine::LaneState BatchedVoiceEngine::createLaneState(int fftSize, int numVoices)
+{
+    LaneState state;
+    state.binStride = fftSize / 2 + 1;
+    state.numGroups = (numVoices + L - 1) / L;
+    size_t laneState = static_cast<size_t>(state.numGroups) * static_cast<size_t>(state.binStride) * L;
+    state.previousPhase.assign(laneState, 0.0f);
+    state.synthesisPhase.assign(laneState, 0.0f);
+    state.magnitude.assign(static_cast<size_t>(state.binStride) * L, 0.0f);
+    state.phaseAdvance.assign(static_cast<size_t>(state.binStride) * L, 0.0f);
+    return state;
+}
+
+void BatchedVoiceEngine::adoptLaneState(LaneState& state) noexcept
+{
+    if (state.binStride < binStride || state.numGroups < numGroups || (state.binStride == binStride && state.numGroups == numGroups)) return;
+    std::swap(binStride, state.binStride);
+    std::swap(numGroups, state.numGroups);
+    previousPhase.swap(state.previousPhase);
+    synthesisPhase.swap(state.synthesisPhase);
+    magnitude.swap(state.magnitude);
+    phaseAdvance.swap(state.phaseAdvance);
+    // Changing the layout drops all phase state; voices restart their phase tracks.
+}
+
+bool BatchedVoiceEngine::isApplicable(int numVoices) const
+{
+    // Lane state is only ever sized off the audio thread (with the voice buffers), so until it fits, render per voice
+    bool sized = processor.getCurrentFftSize() / 2 + 1 <= binStride && numVoices <= numGroups * L;
+    return sized && processor.midiModeParam->get() && !processor.isTrueStereoActive() && !processor.phaseLockParam->get();
+}
+
+void BatchedVoiceEngine::resetLane(int group, int lane)
+{
+    size_t base = static_cast<size_t>(group) * static_cast<size_t>(binStride) * L + static_cast<size_t>(lane);
+    for (int bin = 0; bin < binStride; ++bin) {
+        previousPhase[base + static_cast<size_t>(bin) * L] = 0.0f;
+        synthesisPhase[base + static_cast<size_t>(bin) * L] = 0.0f;
+    }
+}
+
+void BatchedVoiceEngine::render(const juce::OwnedArray<juce::SynthesiserVoice>& voices, juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    GF_TRACE_SCOPE("batch.render");
+    while (numSamples > 0) {
+        processDueFrames(voices, startSample);
+
+        // Run every voice up to the next sample on which any of them needs a frame
+        int segment = numSamples;
+        for (auto* v : voices)
+            if (v->isVoiceActive()) segment = juce::jmin(segment, static_cast<GrainfreezeVoice*>(v)->grainCounter);
+        segment = juce::jmax(1, segment);
+        for (auto* v : voices)
+            if (v->isVoiceActive()) v->renderNextBlock(output, startSample, segment);
+
+        startSample += segment;
+        numSamples -= segment;
+    }
+}
+
+void BatchedVoiceEngine::processDueFrames(const juce::OwnedArray<juce::SynthesiserVoice>& voices, int blockSample)
+{
+    int fftSize = processor.getCurrentFftSize();
+    int hopSize = processor.getCurrentHopSize();
+    jassert(fftSize / 2 + 1 <= binStride && voices.size() <= numGroups * L);   // checked by isApplicable
+
+    for (int g = 0; g < numGroups; ++g) {
+        GrainfreezeVoice* lanes[L] = {};
+        bool anyDue = false;
+        for (int l = 0; l < L; ++l) {
+            int idx = g * L + l;
+            if (idx >= voices.size()) break;
+            auto* v = static_cast<GrainfreezeVoice*>(voices.getUnchecked(idx));
+            if (!v->isVoiceActive() || v->grainCounter > 0) continue;
+            if (v->laneNeedsReset) { resetLane(g, l); v->laneNeedsReset = false; }
+            v->prepareFft(fftSize);
+            v->grainCounter = hopSize;
+            v->frameSample = blockSample;
+            lanes[l] = v;
+            anyDue = true;
+        }
+        if (anyDue) processGroup(lanes, g, fftSize, hopSize);
+    }
+}
+
+void BatchedVoiceEngine::processGroup(GrainfreezeVoice* const* lanes, int group, int fftSize, int hopSize)
+{
+    GF_TRACE_SCOPE("batch.frame");
+    const int numBins = fftSize / 2 + 1;
+    float* prev = previousPhase.data() + static_cast<size_t>(group) * static_cast<size_t>(binStride) * L;
+    float* synthPh = synthesisPhase.data() + static_cast<size_t>(group) * static_cast<size_t>(binStride) * L;
+    float* mag = magnitude.data();
+    float* adv = phaseAdvance.data();
+
+    // Lanes whose voice is not due this frame run along on zeros; their phase state is
+    // blended back unchanged (x * 1 + y * 0 is exact) so the voice keeps its phase track.
+    float due[L];
+    for (int l = 0; l < L; ++l) due[l] = mask(lanes[l] != nullptr);
+
+    for (int l = 0; l < L; ++l)
+        if (lanes[l] != nullptr) lanes[l]->analyseFrame();
+
+    // Gather each voice's interleaved spectrum into the lane layout (re -> mag, im -> adv)
+    for (int l = 0; l < L; ++l) {
+        const float* fb = lanes[l] != nullptr ? lanes[l]->fftBuffer.data() : nullptr;
+        for (int bin = 0; bin < numBins; ++bin) {
+            mag[bin * L + l] = fb != nullptr ? fb[bin * 2] : 0.0f;
+            adv[bin * L + l] = fb != nullptr ? fb[bin * 2 + 1] : 0.0f;
+        }
+    }
+
+    // Phase analysis for all lanes at once
+    {
+        GF_TRACE_SCOPE("batch.analysis");
+        float expPhaseAdv = twoPi * static_cast<float>(hopSize) / static_cast<float>(fftSize);
+        for (int bin = 0; bin < numBins; ++bin) {
+            float expected = static_cast<float>(bin) * expPhaseAdv;
+            float re[L], im[L], p[L], ph[L];
+            for (int l = 0; l < L; ++l) { re[l] = mag[bin * L + l]; im[l] = adv[bin * L + l]; p[l] = prev[bin * L + l]; }
+            for (int l = 0; l < L; ++l) {
+                ph[l] = fastAtan2(im[l], re[l]);
+                re[l] = std::sqrt(re[l] * re[l] + im[l] * im[l]);
+                im[l] = expected + wrapPhase(ph[l] - p[l] - expected);
+            }
+            for (int l = 0; l < L; ++l) { mag[bin * L + l] = re[l]; adv[bin * L + l] = im[l]; prev[bin * L + l] = ph[l] * due[l] + p[l] * (1.0f - due[l]); }
+        }
+    }
+
+    // Pitch remap and resynthesis; interpolation weights are shared by every lane
+    {
+        GF_TRACE_SCOPE("batch.synthesis");
+        float pf = std::pow(2.0f, processor.pitchShiftParam->get() / 12.0f);
+        float boost = processor.hfBoostParam->get() / 100.0f;
+        float* out[L];
+        for (int l = 0; l < L; ++l) out[l] = lanes[l] != nullptr ? lanes[l]->fftBuffer.data() : nullptr;
+
+        for (int bin = 0; bin < numBins; ++bin) {
+            float srcBin = static_cast<float>(bin) / pf;
+            float m[L] = {}, a[L] = {}, s0[L], s[L], re[L], im[L];
+            if (srcBin < static_cast<float>(numBins - 1)) {
+                int bL = static_cast<int>(srcBin); float wU = srcBin - static_cast<float>(bL);
+                const float* m0 = mag + bL * L; const float* a0 = adv + bL * L;
+                for (int l = 0; l < L; ++l) {
+                    m[l] = m0[l] * (1.0f - wU) + m0[l + L] * wU;
+                    a[l] = (a0[l] * (1.0f - wU) + a0[l + L] * wU) * pf;
+                }
+            }
+            float gain = 1.0f + (static_cast<float>(bin) / static_cast<float>(numBins - 1) * boost);
+            for (int l = 0; l < L; ++l) s0[l] = synthPh[bin * L + l];
+            for (int l = 0; l < L; ++l) {
+                m[l] *= gain;
+                s[l] = wrapPhase(s0[l] + a[l]);
+                float sn, cs; fastSinCos(s[l], sn, cs);
+                re[l] = m[l] * cs; im[l] = m[l] * sn;
+            }
+            float peak = 0.0f;
+            for (int l = 0; l < L; ++l) { synthPh[bin * L + l] = s[l] * due[l] + s0[l] * (1.0f - due[l]); peak = juce::jmax(peak, m[l]); }
+            processor.updateVoiceSpectrum(bin, peak);
+
+            for (int l = 0; l < L; ++l)
+                if (out[l] != nullptr) { out[l][bin * 2] = re[l]; out[l][bin * 2 + 1] = im[l]; }
+        }
+    }
+
+    for (int l = 0; l < L; ++l)
+        if (lanes[l] != nullptr) lanes[l]->synthesiseFrame();
+}
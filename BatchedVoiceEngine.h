@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+class GrainfreezeAudioProcessor;
+class GrainfreezeVoice;
+
+//==============================================================================
+/** Renders MIDI-mode voices on a shared frame clock so the per-bin vocoder work
+    of up to numLanes voices runs in one pass.
+
+    Phase state lives here rather than in the voices, structure-of-arrays and
+    interleaved by bin ([group][bin][lane]). The phase-advance, wrap, pitch remap
+    and sin/cos steps are then unit-stride loops over the lanes, which the compiler
+    turns into SIMD, and the remap weights are computed once per bin for all lanes.
+    Forward and inverse FFTs still run per voice.
+
+    Each voice keeps its own frame clock, so a note's first frame runs on the sample
+    it starts, exactly as on the per-voice path. Voices whose frames fall due on the
+    same sample (e.g. the notes of a chord) share one pass; lanes that are not due
+    sit idle. True-stereo and phase-locked rendering use the per-voice path.
+*/
+class BatchedVoiceEngine
+{
+public:
+    static constexpr int numLanes = 8;
+
+    explicit BatchedVoiceEngine(GrainfreezeAudioProcessor& p) : processor(p) {}
+
+    /** Lane state for an FFT size and voice count, allocated without touching the engine. */
+    struct LaneState
+    {
+        int binStride = 0;
+        int numGroups = 0;
+        std::vector<float> previousPhase, synthesisPhase, magnitude, phaseAdvance;
+    };
+
+    static LaneState createLaneState(int fftSize, int numVoices);
+
+    /** Swaps state in if it is larger than the current layout, leaving the old buffers
+        in state for the caller to free. Drops all phase state when it swaps. */
+    void adoptLaneState(LaneState& state) noexcept;
+
+    /** True when the current settings can be rendered batched and the lane state,
+        sized off the audio thread, covers the current FFT size and numVoices. */
+    bool isApplicable(int numVoices) const;
+
+    void render(const juce::OwnedArray<juce::SynthesiserVoice>& voices, juce::AudioBuffer<float>& output, int startSample, int numSamples);
+
+private:
+    GrainfreezeAudioProcessor& processor;
+    int binStride = 0;
+    int numGroups = 0;
+
+    std::vector<float> previousPhase;   // [group][bin][lane]
+    std::vector<float> synthesisPhase;  // [group][bin][lane]
+    std::vector<float> magnitude;       // [bin][lane], scratch
+    std::vector<float> phaseAdvance;    // [bin][lane], scratch
+
+    void resetLane(int group, int lane);
+    void processDueFrames(const juce::OwnedArray<juce::SynthesiserVoice>& voices, int blockSample);
+    void processGroup(GrainfreezeVoice* const* lanes, int group, int fftSize, int hopSize);
+
+    JUCE_DECLARE_NON_COPYABLE(BatchedVoiceEngine)
+};
@@ -0,0 +1,177 @@
+#include "CaptureRing.h"
+
+//==============================================================================
+// SampleSourceView
+//==============================================================================
+
+SampleSourceView SampleSourceView::fromBuffer(const juce::AudioBuffer<float>& buffer) noexcept
+{
+    SampleSourceView v;
+    v.numChannels = juce::jmin(2, buffer.getNumChannels());
+    for (int ch = 0; ch < v.numChannels; ++ch) v.channels[ch] = buffer.getReadPointer(ch);
+    v.length = v.numChannels > 0 ? buffer.getNumSamples() : 0;
+    return v;
+}
+
+SampleSourceView SampleSourceView::fromPlanes(const void* const* planes, int numCh, int numSamples, Encoding enc) noexcept
+{
+    SampleSourceView v;
+    v.numChannels = juce::jlimit(0, 2, numCh);
+    for (int ch = 0; ch < v.numChannels; ++ch) v.channels[ch] = planes[ch];
+    v.encoding = enc;
+    v.length = v.numChannels > 0 ? numSamples : 0;
+    return v;
+}
+
+void SampleSourceView::decode(int ch, int start, float* dest, int num, bool accumulate) const noexcept
+{
+    switch (encoding) {
+        case Encoding::Float32: {
+            auto* src = static_cast<const float*>(channels[ch]) + start;
+            if (accumulate) juce::FloatVectorOperations::add(dest, src, num);
+            else juce::FloatVectorOperations::copy(dest, src, num);
+            break;
+        }
+        case Encoding::Int16: {
+            // Plain loops so the compiler can vectorise the int -> float conversion
+            constexpr float scale = 1.0f / 32767.0f;
+            auto* src = static_cast<const juce::int16*>(channels[ch]) + start;
+            if (accumulate) for (int i = 0; i < num; ++i) dest[i] += static_cast<float>(src[i]) * scale;
+            else for (int i = 0; i < num; ++i) dest[i] = static_cast<float>(src[i]) * scale;
+            break;
+        }
+        case Encoding::Int24: {
+            constexpr float scale = 1.0f / 8388607.0f;
+            auto* src = static_cast<const juce::uint8*>(channels[ch]) + 3 * start;
+            for (int i = 0; i < num; ++i) {
+                int v = src[3 * i] | (src[3 * i + 1] << 8) | (src[3 * i + 2] << 16);
+                float s = static_cast<float>((v ^ 0x800000) - 0x800000) * scale;   // sign-extend 24 bits
+                dest[i] = accumulate ? dest[i] + s : s;
+            }
+            break;
+        }
+    }
+}
+
+void SampleSourceView::readMono(float* dest, int start, int num) const noexcept
+{
+    int i = 0;
+    while (i < num) {
+        int idx = start + i;
+        if (idx < 0 || idx >= length) { dest[i++] = 0.0f; continue; }
+
+        // Longest run that neither leaves the view nor wraps around the ring
+        int phys = (offset + idx) & mask;
+        int run = juce::jmin(num - i, length - idx);
+        if (mask != -1) run = juce::jmin(run, mask + 1 - phys);
+
+        decode(0, phys, dest + i, run, false);
+        if (numChannels > 1) {
+            decode(1, phys, dest + i, run, true);
+            juce::FloatVectorOperations::multiply(dest + i, 0.5f, run);
+        }
+        i += run;
+    }
+    if (fadeFrom != nullptr) mixInFade(dest, start, num, false);
+}
+
+void SampleSourceView::readStereo(float* dest, int start, int num) const noexcept
+{
+    // Decode each run per channel into stack scratch, then interleave
+    constexpr int chunk = 256;
+    float left[chunk], right[chunk];
+    const float* rightSource = numChannels > 1 ? right : left;
+    int i = 0;
+    while (i < num) {
+        int idx = start + i;
+        if (idx < 0 || idx >= length) { dest[2 * i] = dest[2 * i + 1] = 0.0f; ++i; continue; }
+
+        int phys = (offset + idx) & mask;
+        int run = juce::jmin(chunk, num - i, length - idx);
+        if (mask != -1) run = juce::jmin(run, mask + 1 - phys);
+
+        decode(0, phys, left, run, false);
+        if (numChannels > 1) decode(1, phys, right, run, false);
+        float* out = dest + 2 * i;
+        for (int k = 0; k < run; ++k) { out[2 * k] = left[k]; out[2 * k + 1] = rightSource[k]; }
+        i += run;
+    }
+    if (fadeFrom != nullptr) mixInFade(dest, start, num, true);
+}
+
+SampleSourceView SampleSourceView::withFadeFrom(const SampleSourceView& previous, float gain) const noexcept
+{
+    jassert(previous.fadeFrom == nullptr);
+    SampleSourceView v = *this;
+    v.fadeFrom = &previous;
+    v.fadeGain = gain;
+    return v;
+}
+
+void SampleSourceView::mixInFade(float* dest, int start, int num, bool stereo) const noexcept
+{
+    int width = stereo ? 2 : 1;
+    juce::FloatVectorOperations::multiply(dest, fadeGain, num * width);
+
+    // Small stack chunks keep this allocation-free on the audio thread
+    constexpr int chunk = 256;
+    float previous[chunk * 2];
+    for (int done = 0; done < num; done += chunk) {
+        int n = juce::jmin(chunk, num - done);
+        if (stereo) fadeFrom->readStereo(previous, start + done, n);
+        else fadeFrom->readMono(previous, start + done, n);
+        juce::FloatVectorOperations::addWithMultiply(dest + done * width, previous, 1.0f - fadeGain, n * width);
+    }
+}
+
+//==============================================================================
+// CaptureRing
+//==============================================================================
+
+void CaptureRing::prepare(int numChannels, int minimumSamples)
+{
+    int capacity = juce::nextPowerOfTwo(juce::jmax(1, minimumSamples));
+    numChannels = juce::jlimit(1, 2, numChannels);
+    if (buffer.getNumChannels() != numChannels || buffer.getNumSamples() != capacity)
+        buffer.setSize(numChannels, capacity);
+    buffer.clear();
+    mask = capacity - 1;
+    writeHead.store(0, std::memory_order_release);
+}
+
+void CaptureRing::release()
+{
+    buffer.setSize(0, 0);
+    mask = 0;
+    writeHead.store(0, std::memory_order_release);
+}
+
+void CaptureRing::write(const juce::AudioBuffer<float>& input, int numChannels, int numSamples) noexcept
+{
+    if (!isPrepared() || numChannels <= 0) return;
+    numSamples = juce::jmin(numSamples, mask + 1);
+
+    auto head = writeHead.load(std::memory_order_relaxed);
+    int start = static_cast<int>(head & mask);
+    int first = juce::jmin(numSamples, mask + 1 - start);
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        const float* src = input.getReadPointer(juce::jmin(ch, numChannels - 1));
+        buffer.copyFrom(ch, start, src, first);
+        if (first < numSamples) buffer.copyFrom(ch, 0, src + first, numSamples - first);
+    }
+    writeHead.store(head + numSamples, std::memory_order_release);
+}
+
+SampleSourceView CaptureRing::getView(int maxLength) const noexcept
+{
+    SampleSourceView v;
+    if (!isPrepared()) return v;
+
+    auto head = writeHead.load(std::memory_order_acquire);
+    v.numChannels = buffer.getNumChannels();
+    for (int ch = 0; ch < v.numChannels; ++ch) v.channels[ch] = buffer.getReadPointer(ch);
+    v.length = static_cast<int>(juce::jmin(head, static_cast<juce::int64>(juce::jmin(maxLength, mask + 1))));
+    v.offset = static_cast<int>((head - v.length) & mask);
+    v.mask = mask;
+    return v;
+}
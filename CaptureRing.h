@@ -0,0 +1,90 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+/** Read-only view of the audio the voices analyse: either a decoded file or the
+    newest stretch of the live capture ring. Cheap to copy; index 0 is the oldest
+    sample in the view and anything outside [0, getNumSamples()) reads as silence.
+    Files may be held as packed PCM, which is converted to float as it is read.
+*/
+class SampleSourceView
+{
+public:
+    enum class Encoding { Float32, Int16, Int24 };
+
+    SampleSourceView() = default;
+
+    /** Linear view over a whole buffer. */
+    static SampleSourceView fromBuffer(const juce::AudioBuffer<float>& buffer) noexcept;
+
+    /** Linear view over one plane per channel in the given encoding (Int24 is packed little-endian, 3 bytes). */
+    static SampleSourceView fromPlanes(const void* const* planes, int numChannels, int numSamples, Encoding encoding) noexcept;
+
+    int getNumSamples() const noexcept { return length; }
+    int getNumChannels() const noexcept { return numChannels; }
+
+    /** Writes num samples starting at start, averaged over the (up to two) channels. */
+    void readMono(float* dest, int start, int num) const noexcept;
+
+    /** Writes num interleaved (left, right) pairs; a mono source fills both. */
+    void readStereo(float* dest, int start, int num) const noexcept;
+
+    /** A copy whose reads mix in previous at (1 - gain), for fading between sources.
+        previous must outlive the copy and must not itself be fading. */
+    SampleSourceView withFadeFrom(const SampleSourceView& previous, float gain) const noexcept;
+
+private:
+    friend class CaptureRing;
+
+    void decode(int channel, int start, float* dest, int num, bool accumulate) const noexcept;
+    void mixInFade(float* dest, int start, int num, bool stereo) const noexcept;
+
+    const void* channels[2] = {};
+    Encoding encoding = Encoding::Float32;
+    int numChannels = 0;
+    int length = 0;
+    int offset = 0;
+    int mask = -1;   // ring capacity - 1, or all bits set for a linear buffer
+    const SampleSourceView* fadeFrom = nullptr;
+    float fadeGain = 1.0f;
+};
+
+//==============================================================================
+/** Lock-free, preallocated ring holding the most recent live input.
+
+    Written by the audio callback only; voices read it through getView() on the
+    same callback (or, offline, from worker threads that run after the write).
+    The capacity is a power of two so wrapping is a mask.
+*/
+class CaptureRing
+{
+public:
+    CaptureRing() = default;
+
+    /** Allocates room for at least minimumSamples per channel; not for the audio thread. */
+    void prepare(int numChannels, int minimumSamples);
+    void release();
+    bool isPrepared() const noexcept { return mask > 0; }
+
+    /** Appends the first numChannels of input. The ring keeps the channel count given to
+        prepare() (at most two), so mono input stays a mono ring that readStereo() duplicates;
+        if the ring has more channels than numChannels, the last input channel fills the rest. */
+    void write(const juce::AudioBuffer<float>& input, int numChannels, int numSamples) noexcept;
+
+    /** Forgets everything captured so far, without touching the memory; safe on the audio thread. */
+    void reset() noexcept { writeHead.store(0, std::memory_order_release); }
+
+    /** The newest maxLength samples (fewer until that much has been captured). */
+    SampleSourceView getView(int maxLength) const noexcept;
+
+    juce::int64 getNumWritten() const noexcept { return writeHead.load(std::memory_order_acquire); }
+
+private:
+    juce::AudioBuffer<float> buffer;
+    int mask = 0;
+    std::atomic<juce::int64> writeHead{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CaptureRing)
+};
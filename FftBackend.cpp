@@ -0,0 +1,300 @@
+#include "FftBackend.h"
+#include <array>
+#include <atomic>
+#include <limits>
+#include <mutex>
+
+#if GRAINFREEZE_USE_FFTW
+ #include <fftw3.h>
+#endif
+
+//==============================================================================
+// RadixFftBackend
+//==============================================================================
+
+RadixFftBackend::RadixFftBackend(int fftOrder) : FftBackend(fftOrder)
+{
+    jassert(fftOrder >= 2);
+    complexSize = getSize() / 2;
+    const int n = complexSize;
+
+    stageTwiddles.reserve(static_cast<size_t>(4 * n));
+    for (int len = 2; len <= 2 * n; len <<= 1)
+        for (int j = 0; j < len / 2; ++j) {
+            double a = -juce::MathConstants<double>::twoPi * static_cast<double>(j) / static_cast<double>(len);
+            stageTwiddles.push_back(static_cast<float>(std::cos(a)));
+            stageTwiddles.push_back(static_cast<float>(std::sin(a)));
+        }
+
+    auto buildSwaps = [](int points, std::vector<int>& swaps) {
+        for (int i = 1, j = 0; i < points; ++i) {
+            int bit = points >> 1;
+            for (; (j & bit) != 0; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) { swaps.push_back(i); swaps.push_back(j); }
+        }
+    };
+    buildSwaps(n, bitReverseSwaps);
+    buildSwaps(2 * n, fullBitReverseSwaps);
+
+    splitTwiddles.reserve(static_cast<size_t>(n + 2));
+    for (int k = 0; k <= n / 2; ++k) {
+        double a = -juce::MathConstants<double>::pi * static_cast<double>(k) / static_cast<double>(n);
+        splitTwiddles.push_back(static_cast<float>(std::cos(a)));
+        splitTwiddles.push_back(static_cast<float>(std::sin(a)));
+    }
+}
+
+void RadixFftBackend::transformInPlace(float* d, int n, const std::vector<int>& swaps, bool inverse) const noexcept
+{
+    for (size_t s = 0; s < swaps.size(); s += 2) {
+        size_t a = static_cast<size_t>(swaps[s]) * 2, b = static_cast<size_t>(swaps[s + 1]) * 2;
+        std::swap(d[a], d[b]); std::swap(d[a + 1], d[b + 1]);
+    }
+
+    const float sign = inverse ? -1.0f : 1.0f;
+    const float* w = stageTwiddles.data();
+    for (int len = 2; len <= n; len <<= 1) {
+        const int half = len / 2;
+        for (int start = 0; start < n; start += len) {
+            float* a = d + 2 * start;
+            float* b = a + 2 * half;
+            for (int j = 0; j < half; ++j) {
+                float wr = w[2 * j], wi = sign * w[2 * j + 1];
+                float br = b[2 * j] * wr - b[2 * j + 1] * wi, bi = b[2 * j] * wi + b[2 * j + 1] * wr;
+                float ar = a[2 * j], ai = a[2 * j + 1];
+                a[2 * j] = ar + br; a[2 * j + 1] = ai + bi;
+                b[2 * j] = ar - br; b[2 * j + 1] = ai - bi;
+            }
+        }
+        w += 2 * half;
+    }
+}
+
+void RadixFftBackend::performRealOnlyForwardTransform(float* d, bool onlyNonNegative) const noexcept
+{
+    const int n = complexSize;
+    transformInPlace(d, n, bitReverseSwaps, false);
+
+    // Split the packed even/odd spectrum: X[k] = E[k] + W^k O[k]
+    float z0r = d[0], z0i = d[1];
+    d[0] = z0r + z0i; d[1] = 0.0f;
+    d[2 * n] = z0r - z0i; d[2 * n + 1] = 0.0f;
+    for (int k = 1; k <= n / 2; ++k) {
+        int m = n - k;
+        float ar = d[2 * k], ai = d[2 * k + 1], br = d[2 * m], bi = d[2 * m + 1];
+        float er = 0.5f * (ar + br), ei = 0.5f * (ai - bi);
+        float orr = 0.5f * (ai + bi), oi = -0.5f * (ar - br);
+        float wr = splitTwiddles[static_cast<size_t>(2 * k)], wi = splitTwiddles[static_cast<size_t>(2 * k + 1)];
+        float tr = orr * wr - oi * wi, ti = orr * wi + oi * wr;
+        d[2 * k] = er + tr; d[2 * k + 1] = ei + ti;
+        d[2 * m] = er - tr; d[2 * m + 1] = ti - ei;
+    }
+
+    if (!onlyNonNegative) {
+        const int size = getSize();
+        for (int k = n + 1; k < size; ++k) { d[2 * k] = d[2 * (size - k)]; d[2 * k + 1] = -d[2 * (size - k) + 1]; }
+    }
+}
+
+void RadixFftBackend::performRealOnlyInverseTransform(float* d) const noexcept
+{
+    const int n = complexSize;
+
+    // Rebuild the packed spectrum Z[k] = E[k] + i O[k]; like juce::dsp::FFT the
+    // imaginary parts of DC and Nyquist are ignored.
+    float x0 = d[0], xn = d[2 * n];
+    d[0] = 0.5f * (x0 + xn); d[1] = 0.5f * (x0 - xn);
+    for (int k = 1; k <= n / 2; ++k) {
+        int m = n - k;
+        float ar = d[2 * k], ai = d[2 * k + 1], br = d[2 * m], bi = d[2 * m + 1];
+        float er = 0.5f * (ar + br), ei = 0.5f * (ai - bi);
+        float dr = 0.5f * (ar - br), di = 0.5f * (ai + bi);
+        float wr = splitTwiddles[static_cast<size_t>(2 * k)], wi = -splitTwiddles[static_cast<size_t>(2 * k + 1)];
+        float orr = dr * wr - di * wi, oi = dr * wi + di * wr;
+        d[2 * k] = er - oi; d[2 * k + 1] = ei + orr;
+        d[2 * m] = er + oi; d[2 * m + 1] = orr - ei;
+    }
+
+    transformInPlace(d, n, bitReverseSwaps, true);
+    juce::FloatVectorOperations::multiply(d, 1.0f / static_cast<float>(n), 2 * n);
+}
+
+void RadixFftBackend::performComplex(const float* input, float* output, bool inverse) const noexcept
+{
+    const int size = getSize();
+    std::copy(input, input + 2 * size, output);
+    transformInPlace(output, size, fullBitReverseSwaps, inverse);
+    if (inverse) juce::FloatVectorOperations::multiply(output, 1.0f / static_cast<float>(size), 2 * size);
+}
+
+//==============================================================================
+// FftwFftBackend
+//==============================================================================
+
+#if GRAINFREEZE_USE_FFTW
+namespace
+{
+    // The FFTW planner is not thread-safe; execution with the new-array API is.
+    std::mutex& getFftwPlannerMutex() { static std::mutex m; return m; }
+}
+
+class FftwFftBackend : public FftBackend
+{
+public:
+    explicit FftwFftBackend(int fftOrder) : FftBackend(fftOrder)
+    {
+        const int n = getSize();
+        std::lock_guard<std::mutex> lock(getFftwPlannerMutex());
+        float* tmp = fftwf_alloc_real(static_cast<size_t>(2 * (n / 2 + 1)));
+        forwardPlan = fftwf_plan_dft_r2c_1d(n, tmp, reinterpret_cast<fftwf_complex*>(tmp), FFTW_ESTIMATE | FFTW_UNALIGNED);
+        inversePlan = fftwf_plan_dft_c2r_1d(n, reinterpret_cast<fftwf_complex*>(tmp), tmp, FFTW_ESTIMATE | FFTW_UNALIGNED);
+        fftwf_free(tmp);
+
+        auto* in = fftwf_alloc_complex(static_cast<size_t>(n));
+        auto* out = fftwf_alloc_complex(static_cast<size_t>(n));
+        complexForwardPlan = fftwf_plan_dft_1d(n, in, out, FFTW_FORWARD, FFTW_ESTIMATE | FFTW_UNALIGNED);
+        complexInversePlan = fftwf_plan_dft_1d(n, in, out, FFTW_BACKWARD, FFTW_ESTIMATE | FFTW_UNALIGNED);
+        fftwf_free(in);
+        fftwf_free(out);
+    }
+
+    ~FftwFftBackend() override
+    {
+        std::lock_guard<std::mutex> lock(getFftwPlannerMutex());
+        fftwf_destroy_plan(forwardPlan);
+        fftwf_destroy_plan(inversePlan);
+        fftwf_destroy_plan(complexForwardPlan);
+        fftwf_destroy_plan(complexInversePlan);
+    }
+
+    void performRealOnlyForwardTransform(float* d, bool onlyNonNegative) const noexcept override
+    {
+        fftwf_execute_dft_r2c(forwardPlan, d, reinterpret_cast<fftwf_complex*>(d));
+        if (!onlyNonNegative) {
+            const int size = getSize();
+            for (int k = size / 2 + 1; k < size; ++k) { d[2 * k] = d[2 * (size - k)]; d[2 * k + 1] = -d[2 * (size - k) + 1]; }
+        }
+    }
+
+    void performRealOnlyInverseTransform(float* d) const noexcept override
+    {
+        fftwf_execute_dft_c2r(inversePlan, reinterpret_cast<fftwf_complex*>(d), d);
+        juce::FloatVectorOperations::multiply(d, 1.0f / static_cast<float>(getSize()), getSize());
+    }
+
+    void performComplex(const float* input, float* output, bool inverse) const noexcept override
+    {
+        // Out-of-place complex plans leave the input untouched, so the const_cast is safe.
+        fftwf_execute_dft(inverse ? complexInversePlan : complexForwardPlan,
+                          reinterpret_cast<fftwf_complex*>(const_cast<float*>(input)), reinterpret_cast<fftwf_complex*>(output));
+        if (inverse) juce::FloatVectorOperations::multiply(output, 1.0f / static_cast<float>(getSize()), 2 * getSize());
+    }
+
+    Kind getKind() const noexcept override { return Kind::Fftw; }
+
+private:
+    fftwf_plan forwardPlan = nullptr;
+    fftwf_plan inversePlan = nullptr;
+    fftwf_plan complexForwardPlan = nullptr;
+    fftwf_plan complexInversePlan = nullptr;
+};
+#endif
+
+//==============================================================================
+// Factory & backend selection
+//==============================================================================
+
+namespace { std::atomic<int> forcedKind{ -1 }; }
+
+void FftBackend::forceKind(Kind kind) { if (isAvailable(kind)) forcedKind.store(static_cast<int>(kind)); }
+
+bool FftBackend::isAvailable(Kind kind)
+{
+   #if GRAINFREEZE_USE_FFTW
+    juce::ignoreUnused(kind);
+    return true;
+   #else
+    return kind != Kind::Fftw;
+   #endif
+}
+
+const char* FftBackend::getKindName(Kind kind)
+{
+    switch (kind) {
+        case Kind::Juce:  return "JUCE";
+        case Kind::Radix: return "Radix";
+        case Kind::Fftw:  return "FFTW";
+    }
+    return "?";
+}
+
+std::unique_ptr<FftBackend> FftBackend::create(Kind kind, int order)
+{
+    switch (kind) {
+        case Kind::Juce:  return std::make_unique<JuceFftBackend>(order);
+        case Kind::Radix: return std::make_unique<RadixFftBackend>(order);
+        case Kind::Fftw:
+           #if GRAINFREEZE_USE_FFTW
+            return std::make_unique<FftwFftBackend>(order);
+           #else
+            return nullptr;
+           #endif
+    }
+    return nullptr;
+}
+
+std::unique_ptr<FftBackend> FftBackend::createFastest(int order) { return create(getFastestKind(order), order); }
+
+const FftBackend& FftBackend::getShared(int order)
+{
+    static std::mutex sharedMutex;
+    static std::array<std::unique_ptr<FftBackend>, 32> shared;
+
+    jassert(order >= 2 && order < static_cast<int>(shared.size()));
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    auto& fft = shared[static_cast<size_t>(order)];
+    if (fft == nullptr) fft = createFastest(order);
+    return *fft;
+}
+
+FftBackend::Kind FftBackend::getFastestKind(int order)
+{
+    static std::mutex selectionMutex;
+    static std::array<int, 32> selected = [] { std::array<int, 32> a; a.fill(-1); return a; }();
+
+    jassert(order >= 2 && order < static_cast<int>(selected.size()));
+    std::lock_guard<std::mutex> lock(selectionMutex);
+    if (selected[static_cast<size_t>(order)] >= 0) return static_cast<Kind>(selected[static_cast<size_t>(order)]);
+    if (forcedKind.load() >= 0) return static_cast<Kind>(selected[static_cast<size_t>(order)] = forcedKind.load());
+
+    // Time forward + inverse round trips over roughly a million points per trial.
+    const int size = 1 << order;
+    const int passes = juce::jmax(2, (1 << 20) >> order);
+    std::vector<float> buffer(static_cast<size_t>(size * 2));
+    juce::Random rng(order);
+
+    Kind best = Kind::Juce;
+    double bestSeconds = std::numeric_limits<double>::max();
+    for (Kind kind : { Kind::Juce, Kind::Radix, Kind::Fftw }) {
+        auto fft = create(kind, order);
+        if (fft == nullptr) continue;
+        for (auto& s : buffer) s = rng.nextFloat() - 0.5f;
+        fft->performRealOnlyForwardTransform(buffer.data(), true);
+        fft->performRealOnlyInverseTransform(buffer.data());
+
+        double fastestTrial = std::numeric_limits<double>::max();
+        for (int trial = 0; trial < 3; ++trial) {
+            auto start = juce::Time::getHighResolutionTicks();
+            for (int p = 0; p < passes; ++p) {
+                fft->performRealOnlyForwardTransform(buffer.data(), true);
+                fft->performRealOnlyInverseTransform(buffer.data());
+            }
+            fastestTrial = juce::jmin(fastestTrial, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+        }
+        if (fastestTrial < bestSeconds) { bestSeconds = fastestTrial; best = kind; }
+    }
+
+    selected[static_cast<size_t>(order)] = static_cast<int>(best);
+    return best;
+}
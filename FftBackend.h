@@ -0,0 +1,110 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/** Real-only FFT used by the phase vocoder.
+
+    Follows the juce::dsp::FFT calling convention so implementations are drop-in:
+    buffers hold 2 * size floats, the forward transform writes interleaved complex
+    bins and the inverse transform is scaled by 1 / size. All perform calls are
+    const and may run concurrently on the same object.
+
+    performComplex transforms size interleaved complex points out of place, used
+    to run two real channels through one transform (left + i * right).
+*/
+class FftBackend
+{
+public:
+    enum class Kind { Juce, Radix, Fftw };
+
+    virtual ~FftBackend() = default;
+
+    virtual void performRealOnlyForwardTransform(float* data, bool onlyCalculateNonNegativeFrequencies = false) const noexcept = 0;
+    virtual void performRealOnlyInverseTransform(float* data) const noexcept = 0;
+    /** input and output must not overlap; the inverse is scaled by 1 / size. */
+    virtual void performComplex(const float* input, float* output, bool inverse) const noexcept = 0;
+    virtual Kind getKind() const noexcept = 0;
+
+    int getOrder() const noexcept { return order; }
+    int getSize() const noexcept { return 1 << order; }
+
+    /** Returns nullptr if the backend was not compiled in. */
+    static std::unique_ptr<FftBackend> create(Kind kind, int order);
+
+    /** Creates whichever backend benchmarked fastest for this order. */
+    static std::unique_ptr<FftBackend> createFastest(int order);
+
+    /** Process-wide instance of the fastest backend for this order, created on first
+        request and kept until shutdown. Safe to share since all perform calls are const. */
+    static const FftBackend& getShared(int order);
+
+    /** Micro-benchmarks all available backends the first time an order is requested
+        and caches the winner for the lifetime of the process. */
+    static Kind getFastestKind(int order);
+
+    /** Skips the benchmark and uses kind for every order first requested afterwards, so
+        renders do not depend on timing; for tests. Ignored if kind is not compiled in. */
+    static void forceKind(Kind kind);
+
+    static bool isAvailable(Kind kind);
+    static const char* getKindName(Kind kind);
+
+protected:
+    explicit FftBackend(int fftOrder) : order(fftOrder) {}
+
+private:
+    const int order;
+
+    JUCE_DECLARE_NON_COPYABLE(FftBackend)
+};
+
+//==============================================================================
+/** Wraps juce::dsp::FFT (IPP / vDSP / FFTW / generic fallback, depending on the JUCE build). */
+class JuceFftBackend : public FftBackend
+{
+public:
+    explicit JuceFftBackend(int fftOrder) : FftBackend(fftOrder), fft(fftOrder) {}
+
+    void performRealOnlyForwardTransform(float* data, bool onlyNonNegative) const noexcept override { fft.performRealOnlyForwardTransform(data, onlyNonNegative); }
+    void performRealOnlyInverseTransform(float* data) const noexcept override { fft.performRealOnlyInverseTransform(data); }
+    void performComplex(const float* input, float* output, bool inverse) const noexcept override
+    {
+        fft.perform(reinterpret_cast<const juce::dsp::Complex<float>*>(input), reinterpret_cast<juce::dsp::Complex<float>*>(output), inverse);
+    }
+    Kind getKind() const noexcept override { return Kind::Juce; }
+
+private:
+    juce::dsp::FFT fft;
+};
+
+//==============================================================================
+/** Bundled in-place radix-2 FFT.
+
+    A real transform of size N runs as a complex transform of N / 2 followed by a
+    split pass; performComplex runs the same kernel at size N. Twiddles are stored
+    contiguously per stage (a stage's twiddles only depend on its length, so both
+    sizes share them) and the butterfly loops are unit-stride and auto-vectorise.
+    No scratch memory is needed at run time.
+*/
+class RadixFftBackend : public FftBackend
+{
+public:
+    explicit RadixFftBackend(int fftOrder);
+
+    void performRealOnlyForwardTransform(float* data, bool onlyNonNegative) const noexcept override;
+    void performRealOnlyInverseTransform(float* data) const noexcept override;
+    void performComplex(const float* input, float* output, bool inverse) const noexcept override;
+    Kind getKind() const noexcept override { return Kind::Radix; }
+
+private:
+    int complexSize = 1;
+    std::vector<float> stageTwiddles;       // (re, im) per butterfly, stage after stage, up to length getSize()
+    std::vector<float> splitTwiddles;       // e^(-i pi k / complexSize), k <= complexSize / 2
+    std::vector<int> bitReverseSwaps;       // index pairs for complexSize points
+    std::vector<int> fullBitReverseSwaps;   // index pairs for getSize() points
+
+    void transformInPlace(float* data, int n, const std::vector<int>& swaps, bool inverse) const noexcept;
+};
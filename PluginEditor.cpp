@@ -5,34 +5,46 @@
 // WaveformDisplay Implementation
 //==============================================================================
 
-void WaveformDisplay::paint(juce::Graphics& g)
+void WaveformDisplay::renderWaveformImage()
 {
-    g.fillAll(juce::Colours::black);
+    int width = getWidth();
+    int height = getHeight();
+    float scale = juce::Component::getApproximateScaleFactorForComponent(this);
+    waveformImage = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(static_cast<float>(width) * scale)), juce::jmax(1, juce::roundToInt(static_cast<float>(height) * scale)), true);
+    waveformImageVersion = processor.getLoadedAudioVersion();
 
-    if (!processor.isAudioLoaded())
-    {
-        g.setColour(juce::Colours::grey);
-        g.drawText("Load an audio file to begin", getLocalBounds(), juce::Justification::centred);
-        return;
-    }
+    juce::Graphics g(waveformImage);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    g.fillAll(juce::Colours::black);
 
-    const auto& audio = processor.getLoadedAudio();
-    int numSamples = audio.getNumSamples();
+    auto sample = processor.getLoadedSample();   // keeps the audio alive while drawing
+    auto source = sample != nullptr ? sample->getView() : SampleSourceView();
+    int numSamples = source.getNumSamples();
     if (numSamples == 0) return;
-
-    int width = getWidth();
-    int height = getHeight();
     int centerY = height / 2;
 
-    bool isFreeze = processor.freezeModeParam->get();
-    bool isMidi = processor.midiModeParam->get();
-    bool showLoopMarkers = !isFreeze && !isMidi;
-
     // --- Waveform Rendering ---
     g.setColour(juce::Colours::lightblue.withAlpha(0.8f));
+
+    // Zoomed out: draw min/max columns from the shared peak cache instead of sampling the audio
+    if (!sample->peaks.empty() && numSamples / juce::jmax(1, width) >= CachedSample::peakBlockSize)
+    {
+        const auto& peaks = sample->peaks;
+        for (int x = 0; x < width; ++x)
+        {
+            size_t b0 = static_cast<size_t>(static_cast<juce::int64>(x) * numSamples / width / CachedSample::peakBlockSize);
+            size_t b1 = juce::jmax(b0 + 1, static_cast<size_t>(static_cast<juce::int64>(x + 1) * numSamples / width / CachedSample::peakBlockSize));
+            juce::Range<float> r = peaks[juce::jmin(b0, peaks.size() - 1)];
+            for (size_t b = b0 + 1; b < juce::jmin(b1, peaks.size()); ++b) r = r.getUnionWith(peaks[b]);
+            float yTop = static_cast<float>(centerY) - (r.getEnd() * static_cast<float>(centerY) * 0.8f);
+            float yBottom = static_cast<float>(centerY) - (r.getStart() * static_cast<float>(centerY) * 0.8f);
+            g.drawVerticalLine(x, yTop, juce::jmax(yTop + 1.0f, yBottom));
+        }
+        return;
+    }
+
     juce::Path waveformPath;
     bool firstPoint = true;
-    const float* channelData = audio.getReadPointer(0);
 
     for (int x = 0; x < width; ++x)
     {
@@ -40,13 +52,78 @@ void WaveformDisplay::paint(juce::Graphics& g)
         int sampleIndex = static_cast<int>(position * static_cast<float>(numSamples));
         if (sampleIndex >= 0 && sampleIndex < numSamples)
         {
-            float sample = channelData[sampleIndex];
-            float y = static_cast<float>(centerY) - (sample * static_cast<float>(centerY) * 0.8f);
+            float value; source.readMono(&value, sampleIndex, 1);
+            float y = static_cast<float>(centerY) - (value * static_cast<float>(centerY) * 0.8f);
             if (firstPoint) { waveformPath.startNewSubPath(static_cast<float>(x), y); firstPoint = false; }
             else waveformPath.lineTo(static_cast<float>(x), y);
         }
     }
     g.strokePath(waveformPath, juce::PathStrokeType(1.0f));
+}
+
+juce::uint64 WaveformDisplay::computeViewHash() const
+{
+    // FNV-1a over everything paint() draws, quantised to pixels where that applies
+    juce::uint64 h = 14695981039346656037ull;
+    auto mix = [&h](juce::int64 v) { h = (h ^ static_cast<juce::uint64>(v)) * 1099511628211ull; };
+    auto px = [this](float normalised) { return static_cast<juce::int64>(juce::roundToInt(normalised * static_cast<float>(getWidth()))); };
+
+    mix(processor.isAudioLoaded() ? 1 : 0);
+    mix(processor.getLoadedAudioVersion());
+    mix(processor.freezeModeParam->get() ? 1 : 0);
+    mix(processor.midiModeParam->get() ? 1 : 0);
+    mix(processor.isPlaying() ? 1 : 0);
+    mix(px(processor.getPlayheadPosition()));
+    mix(px(processor.loopStartParam->get()));
+    mix(px(processor.loopEndParam->get()));
+    mix(px(processor.midiStartPosParam->get()));
+    mix(px(processor.midiEndPosParam->get()));
+
+    if (processor.midiModeParam->get())
+    {
+        for (int note = 0; note < 128; ++note)
+            mix(juce::roundToInt(processor.midiNoteStates[note].load() * 100.0f));
+
+        auto sample = processor.getLoadedSample();
+        double numSamples = static_cast<double>(juce::jmax(1, sample != nullptr ? sample->getNumSamples() : 0));
+        for (int i = 0; i < processor.synth.getNumVoices(); ++i)
+            if (auto* voice = dynamic_cast<GrainfreezeVoice*>(processor.synth.getVoice(i)))
+                if (voice->isVoiceActive())
+                    mix(px(static_cast<float>(voice->freezeCurrentPosition / numSamples)) * 1000 + juce::roundToInt(voice->currentVelocity * 100.0f));
+    }
+    return h;
+}
+
+void WaveformDisplay::refreshIfChanged()
+{
+    auto h = computeViewHash();
+    if (h != lastViewHash) { lastViewHash = h; repaint(); }
+}
+
+void WaveformDisplay::paint(juce::Graphics& g)
+{
+    auto sample = processor.getLoadedSample();
+    if (sample == nullptr)
+    {
+        g.fillAll(juce::Colours::black);
+        g.setColour(juce::Colours::grey);
+        g.drawText("Load an audio file to begin", getLocalBounds(), juce::Justification::centred);
+        return;
+    }
+
+    int numSamples = sample->getNumSamples();
+    if (numSamples == 0) { g.fillAll(juce::Colours::black); return; }
+
+    if (!waveformImage.isValid() || waveformImageVersion != processor.getLoadedAudioVersion()) renderWaveformImage();
+    g.drawImage(waveformImage, getLocalBounds().toFloat());
+
+    int width = getWidth();
+    int height = getHeight();
+    int centerY = height / 2;
+
+    bool isFreeze = processor.freezeModeParam->get();
+    bool isMidi = processor.midiModeParam->get();
+    bool showLoopMarkers = !isFreeze && !isMidi;
 
     // --- Loop Markers ---
     if (showLoopMarkers)
@@ -157,38 +234,85 @@ void WaveformDisplay::updateFromMouse(const juce::MouseEvent& event)
 
 void SpectrumVisualizer::updateSpectrum(const std::vector<float>& magnitudes, int fftSize, double sampleRate)
 {
-    if (noteMagnitudes.empty()) noteMagnitudes.resize(numNotes, 0.0f);
-    std::fill(noteMagnitudes.begin(), noteMagnitudes.end(), 0.0f);
-    int nb = fftSize / 2 + 1;
+    binnedMagnitudes.fill(0.0f);
+    int nb = juce::jmin(fftSize / 2 + 1, static_cast<int>(magnitudes.size()));
     for (int bin = 1; bin < nb; ++bin) {
         float f = (static_cast<float>(bin) * static_cast<float>(sampleRate)) / static_cast<float>(fftSize);
         int mn = frequencyToMidiNote(f);
-        if (mn >= lowestNote && mn < lowestNote + numNotes) { size_t idx = static_cast<size_t>(mn - lowestNote); noteMagnitudes[idx] = juce::jmax(noteMagnitudes[idx], magnitudes[static_cast<size_t>(bin)]); }
+        if (mn >= lowestNote && mn < lowestNote + numNotes) { size_t idx = static_cast<size_t>(mn - lowestNote); binnedMagnitudes[idx] = juce::jmax(binnedMagnitudes[idx], magnitudes[static_cast<size_t>(bin)]); }
     }
+    if (binnedMagnitudes == noteMagnitudes) return;
+    noteMagnitudes = binnedMagnitudes;
+    barsDirty = true;
     repaint();
 }
 
-void SpectrumVisualizer::paint(juce::Graphics& g)
+juce::Image SpectrumVisualizer::createLayer(bool opaque) const
+{
+    float scale = juce::Component::getApproximateScaleFactorForComponent(this);
+    return juce::Image(opaque ? juce::Image::RGB : juce::Image::ARGB, juce::jmax(1, juce::roundToInt(static_cast<float>(getWidth()) * scale)), juce::jmax(1, juce::roundToInt(static_cast<float>(getHeight()) * scale)), true);
+}
+
+void SpectrumVisualizer::renderBackground()
 {
-    g.fillAll(juce::Colours::black); if (noteMagnitudes.empty()) return;
+    backgroundImage = createLayer(true);
+    juce::Graphics g(backgroundImage);
+    g.addTransform(juce::AffineTransform::scale(juce::Component::getApproximateScaleFactorForComponent(this)));
+    g.fillAll(juce::Colours::black);
+
+    // Octave grid with a C label at the foot of each octave
+    int h = getHeight(); float bw = static_cast<float>(getWidth()) / static_cast<float>(numNotes);
+    g.setFont(9.0f);
+    for (int i = 0; i < numNotes; ++i) {
+        int mn = lowestNote + i;
+        if (mn % 12 != 0) continue;
+        float x = static_cast<float>(i) * bw;
+        g.setColour(juce::Colours::white.withAlpha(0.08f));
+        g.drawVerticalLine(juce::roundToInt(x), 0.0f, static_cast<float>(h));
+        g.setColour(juce::Colours::white.withAlpha(0.3f));
+        g.drawText(midiNoteToName(mn), juce::roundToInt(x) + 2, 2, 30, 10, juce::Justification::left);
+    }
+}
+
+void SpectrumVisualizer::renderBars()
+{
+    if (!barsImage.isValid()) barsImage = createLayer(false);
+    else barsImage.clear(barsImage.getBounds());
+    barsDirty = false;
+
+    juce::Graphics g(barsImage);
+    g.addTransform(juce::AffineTransform::scale(juce::Component::getApproximateScaleFactorForComponent(this)));
     int w = getWidth(); int h = getHeight(); float bw = static_cast<float>(w) / static_cast<float>(numNotes);
     float maxM = 0.0001f; for (float m : noteMagnitudes) maxM = juce::jmax(maxM, m);
-    struct NI { int i; float m; }; std::vector<NI> tn;
-    for (int i = 0; i < numNotes; ++i) if (noteMagnitudes[static_cast<size_t>(i)] > 0.0f) tn.push_back({i, noteMagnitudes[static_cast<size_t>(i)]});
-    std::sort(tn.begin(), tn.end(), [](const NI& a, const NI& b) { return a.m > b.m; });
-    if (tn.size() > 10) tn.resize(10);
+
+    // Ten loudest notes, found without allocating
+    std::array<int, numNotes> order;
+    for (int i = 0; i < numNotes; ++i) order[static_cast<size_t>(i)] = i;
+    const auto numLabels = static_cast<std::ptrdiff_t>(10);
+    std::partial_sort(order.begin(), order.begin() + numLabels, order.end(), [this](int a, int b) { return noteMagnitudes[static_cast<size_t>(a)] > noteMagnitudes[static_cast<size_t>(b)]; });
+
     for (int i = 0; i < numNotes; ++i) {
         float x = static_cast<float>(i) * bw; float nm = noteMagnitudes[static_cast<size_t>(i)] / maxM; float bh = nm * (static_cast<float>(h) - 20.0f);
         if (bh > 1.0f) { juce::Colour c = (nm < 0.5f) ? juce::Colours::blue.interpolatedWith(juce::Colours::cyan, nm * 2.0f) : juce::Colours::cyan.interpolatedWith(juce::Colours::yellow, (nm - 0.5f) * 2.0f); g.setColour(c); g.fillRect(x, static_cast<float>(h) - bh, bw - 1.0f, bh); }
     }
     g.setFont(10.0f);
-    for (const auto& ni : tn) {
-        int mn = lowestNote + ni.i; juce::String name = midiNoteToName(mn);
-        float x = static_cast<float>(ni.i) * bw; float nm = ni.m / maxM; float bh = nm * (static_cast<float>(h) - 20.0f);
+    for (auto it = order.begin(); it != order.begin() + numLabels; ++it) {
+        int i = *it; float m = noteMagnitudes[static_cast<size_t>(i)];
+        if (m <= 0.0f) break;
+        int mn = lowestNote + i; juce::String name = midiNoteToName(mn);
+        float x = static_cast<float>(i) * bw; float nm = m / maxM; float bh = nm * (static_cast<float>(h) - 20.0f);
         if (bh > 15.0f) { g.setColour(juce::Colours::white); float tw = bw * 3.0f; float tx = x - tw / 2.0f + bw / 2.0f; g.drawText(name, static_cast<int>(tx), static_cast<int>(static_cast<float>(h) - bh - 14.0f), static_cast<int>(tw), 12, juce::Justification::centred); }
     }
 }
 
+void SpectrumVisualizer::paint(juce::Graphics& g)
+{
+    if (!backgroundImage.isValid()) renderBackground();
+    g.drawImage(backgroundImage, getLocalBounds().toFloat());
+    if (barsDirty || !barsImage.isValid()) renderBars();
+    g.drawImage(barsImage, getLocalBounds().toFloat());
+}
+
 int SpectrumVisualizer::frequencyToMidiNote(float f) { return (f <= 0.0f) ? -1 : static_cast<int>(std::round(69.0f + 12.0f * std::log2(f / 440.0f))); }
 juce::String SpectrumVisualizer::midiNoteToName(int mn) { const char* names[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" }; return juce::String(names[mn % 12]) + juce::String((mn / 12) - 1); }
 
@@ -207,6 +331,33 @@ GrainfreezeAudioProcessorEditor::GrainfreezeAudioProcessorEditor(GrainfreezeAudi
     addAndMakeVisible(midiModeButton); midiModeButton.setButtonText("MIDI Mode"); midiModeButton.setClickingTogglesState(true);
     midiModeButton.onClick = [this] { if (midiModeButton.getToggleState()) audioProcessor.freezeModeParam->setValueNotifyingHost(0.0f); };
     midiModeAttachment = std::make_unique<ButtonAttachment>(audioProcessor.apvts, "midiMode", midiModeButton);
+    addAndMakeVisible(offlineQualityButton); offlineQualityButton.setButtonText("HQ Bounce");
+    offlineQualityAttachment = std::make_unique<ButtonAttachment>(audioProcessor.apvts, "offlineQuality", offlineQualityButton);
+    addAndMakeVisible(liveInputButton); liveInputButton.setButtonText("Live Input");
+    liveInputAttachment = std::make_unique<ButtonAttachment>(audioProcessor.apvts, "liveInput", liveInputButton);
+    addAndMakeVisible(trueStereoButton); trueStereoButton.setButtonText("True Stereo");
+    trueStereoAttachment = std::make_unique<ButtonAttachment>(audioProcessor.apvts, "trueStereo", trueStereoButton);
+    addAndMakeVisible(stereoLinkButton); stereoLinkButton.setButtonText("Link");
+    stereoLinkAttachment = std::make_unique<ButtonAttachment>(audioProcessor.apvts, "stereoLink", stereoLinkButton);
+    addAndMakeVisible(phaseLockButton); phaseLockButton.setButtonText("Phase Lock");
+    phaseLockAttachment = std::make_unique<ButtonAttachment>(audioProcessor.apvts, "phaseLock", phaseLockButton);
+    addAndMakeVisible(sampleSlotBox);
+    sampleSlotBox.addItemList(audioProcessor.sampleSlotParam->choices, 1);
+    sampleSlotBox.setTooltip("Sample slot: Load Audio fills it, program change switches between slots");
+    sampleSlotAttachment = std::make_unique<ComboBoxAttachment>(audioProcessor.apvts, "sampleSlot", sampleSlotBox);
+    addAndMakeVisible(sampleStorageBox);
+    sampleStorageBox.addItemList({ "Float 32-bit", "PCM 16-bit", "PCM 24-bit", "Mono Float", "Mono PCM 16-bit" }, 1);
+    sampleStorageBox.setTooltip("How loaded audio is held in memory");
+    sampleStorageBox.setSelectedId(static_cast<int>(audioProcessor.getSampleStorage()) + 1, juce::dontSendNotification);
+    sampleStorageBox.onChange = [this] { audioProcessor.setSampleStorage(static_cast<SampleStorage>(sampleStorageBox.getSelectedId() - 1)); };
+    addAndMakeVisible(memoryBudgetBox);
+    for (int mb : { 256, 512, 1024, 2048, 4096, 8192 }) memoryBudgetBox.addItem(mb < 1024 ? juce::String(mb) + " MB" : juce::String(mb / 1024) + " GB", mb);
+    memoryBudgetBox.setTooltip("Memory budget for decoded samples, shared by all instances; least recently used slots are released above it");
+    memoryBudgetBox.setSelectedId(audioProcessor.getSampleMemoryBudget(), juce::dontSendNotification);
+    memoryBudgetBox.onChange = [this] { audioProcessor.setSampleMemoryBudget(memoryBudgetBox.getSelectedId()); };
+   #if GRAINFREEZE_TRACING
+    addAndMakeVisible(saveTraceButton); saveTraceButton.setButtonText("Save Trace"); saveTraceButton.onClick = [this] { saveTrace(); };
+   #endif
     addAndMakeVisible(statusLabel); statusLabel.setText("No audio", juce::dontSendNotification); statusLabel.setJustificationType(juce::Justification::centredLeft);
     addAndMakeVisible(recommendedLabel); recommendedLabel.setText("MIDI Mapping: Linear 0-127", juce::dontSendNotification);
     recommendedLabel.setJustificationType(juce::Justification::centredRight); recommendedLabel.setFont(juce::FontOptions(11.0f).withStyle("Italic"));
@@ -252,7 +403,7 @@ GrainfreezeAudioProcessorEditor::GrainfreezeAudioProcessorEditor(GrainfreezeAudi
     releaseSlider.setTextValueSuffix(" ms"); releaseAttachment = std::make_unique<SliderAttachment>(audioProcessor.apvts, "release", releaseSlider);
     addAndMakeVisible(releaseLabel); releaseLabel.setText("Release", juce::dontSendNotification);
     
-    startTimerHz(30);
+    startTimerHz(activeFrameRateHz);
 }
 
 GrainfreezeAudioProcessorEditor::~GrainfreezeAudioProcessorEditor() {}
@@ -267,7 +418,12 @@ void GrainfreezeAudioProcessorEditor::resized()
     playButton.setBounds(ba.removeFromTop(25)); ba.removeFromTop(5);
     freezeButton.setBounds(ba.removeFromTop(25)); ba.removeFromTop(5);
     syncToDawButton.setBounds(ba.removeFromTop(25)); ba.removeFromTop(5);
-    midiModeButton.setBounds(ba.removeFromTop(25));
+    midiModeButton.setBounds(ba.removeFromTop(25)); ba.removeFromTop(5);
+    offlineQualityButton.setBounds(ba.removeFromTop(25)); ba.removeFromTop(5);
+    liveInputButton.setBounds(ba.removeFromTop(25));
+   #if GRAINFREEZE_TRACING
+    ba.removeFromTop(5); saveTraceButton.setBounds(ba.removeFromTop(25));
+   #endif
     top.removeFromLeft(15); int cw = (top.getWidth() - 30) / 3;
     auto lc = top.removeFromLeft(cw); primaryControlsLabel.setBounds(lc.removeFromTop(20)); lc.removeFromTop(5);
     auto r1 = lc.removeFromTop(30); timeStretchLabel.setBounds(r1.removeFromLeft(60)); timeStretchSlider.setBounds(r1); lc.removeFromTop(2);
@@ -280,23 +436,36 @@ void GrainfreezeAudioProcessorEditor::resized()
     auto r6 = cc.removeFromTop(30); hfBoostLabel.setBounds(r6.removeFromLeft(75)); hfBoostSlider.setBounds(r6); cc.removeFromTop(2);
     auto r7 = cc.removeFromTop(30); microMovementLabel.setBounds(r7.removeFromLeft(75)); microMovementSlider.setBounds(r7); cc.removeFromTop(2);
     auto r8 = cc.removeFromTop(30); windowTypeLabel.setBounds(r8.removeFromLeft(75)); windowTypeSlider.setBounds(r8); cc.removeFromTop(2);
-    auto r9 = cc.removeFromTop(30); crossfadeLengthLabel.setBounds(r9.removeFromLeft(75)); crossfadeLengthSlider.setBounds(r9);
+    auto r9 = cc.removeFromTop(30); crossfadeLengthLabel.setBounds(r9.removeFromLeft(75)); crossfadeLengthSlider.setBounds(r9); cc.removeFromTop(2);
+    auto r9b = cc.removeFromTop(30); int tw = r9b.getWidth() / 3; trueStereoButton.setBounds(r9b.removeFromLeft(tw + 10)); stereoLinkButton.setBounds(r9b.removeFromLeft(tw - 20)); phaseLockButton.setBounds(r9b);
     top.removeFromLeft(15);
     auto rc = top; midiControlsLabel.setBounds(rc.removeFromTop(20)); rc.removeFromTop(5);
     auto r10 = rc.removeFromTop(30); midiStartPosLabel.setBounds(r10.removeFromLeft(80)); midiStartPosSlider.setBounds(r10); rc.removeFromTop(2);
     auto r11 = rc.removeFromTop(30); midiEndPosLabel.setBounds(r11.removeFromLeft(80)); midiEndPosSlider.setBounds(r11); rc.removeFromTop(2);
     auto r12 = rc.removeFromTop(30); attackLabel.setBounds(r12.removeFromLeft(80)); attackSlider.setBounds(r12); rc.removeFromTop(2);
     auto r13 = rc.removeFromTop(30); releaseLabel.setBounds(r13.removeFromLeft(80)); releaseSlider.setBounds(r13);
-    auto sa = b.removeFromBottom(40); recommendedLabel.setBounds(sa.removeFromRight(350)); statusLabel.setBounds(sa);
+    auto sa = b.removeFromBottom(40); recommendedLabel.setBounds(sa.removeFromRight(350)); sampleStorageBox.setBounds(sa.removeFromRight(130).reduced(0, 8)); sa.removeFromRight(5);
+    memoryBudgetBox.setBounds(sa.removeFromRight(80).reduced(0, 8)); sa.removeFromRight(5);
+    sampleSlotBox.setBounds(sa.removeFromRight(90).reduced(0, 8)); statusLabel.setBounds(sa);
     spectrumVisualizer.setBounds(b.removeFromBottom(120).reduced(10, 5));
     waveformDisplay.setBounds(b.reduced(10, 10));
 }
 
 void GrainfreezeAudioProcessorEditor::timerCallback()
 {
-    waveformDisplay.repaint();
-    const auto& m = audioProcessor.getSpectrumMagnitudes();
-    if (!m.empty()) spectrumVisualizer.updateSpectrum(m, audioProcessor.getCurrentFftSize(), audioProcessor.getCurrentSampleRate());
+    bool audioRunning = audioProcessor.isPlaying() || audioProcessor.hasActiveVoices();
+    int targetHz = audioRunning ? activeFrameRateHz : idleFrameRateHz;
+    if (getTimerInterval() != 1000 / targetHz) startTimerHz(targetHz);
+
+    waveformDisplay.refreshIfChanged();
+    int sv = audioProcessor.getSpectrumVersion();
+    if (sv != lastSpectrumVersion) {
+        lastSpectrumVersion = sv;
+        const auto& m = audioProcessor.getSpectrumMagnitudes();
+        if (!m.empty()) spectrumVisualizer.updateSpectrum(m, audioProcessor.getCurrentFftSize(), audioProcessor.getCurrentSampleRate());
+    }
+    sampleStorageBox.setSelectedId(static_cast<int>(audioProcessor.getSampleStorage()) + 1, juce::dontSendNotification);
+    memoryBudgetBox.setSelectedId(audioProcessor.getSampleMemoryBudget(), juce::dontSendNotification);
     bool isF = audioProcessor.freezeModeParam->get();
     freezeButton.setToggleState(isF, juce::dontSendNotification);
     freezeButton.setColour(juce::TextButton::buttonColourId, isF ? juce::Colours::orange : juce::Colours::grey);
@@ -319,3 +488,13 @@ void GrainfreezeAudioProcessorEditor::loadAudioFile()
         auto f = c.getResult(); if (f.existsAsFile()) { audioProcessor.loadAudioFile(f); audioProcessor.setPlaying(false); waveformDisplay.repaint(); }
     });
 }
+
+#if GRAINFREEZE_TRACING
+void GrainfreezeAudioProcessorEditor::saveTrace()
+{
+    fileChooser = std::make_unique<juce::FileChooser>("Save trace...", juce::File::getSpecialLocation(juce::File::userHomeDirectory).getChildFile("grainfreeze-trace.json"), "*.json");
+    fileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles | juce::FileBrowserComponent::warnAboutOverwriting, [](const juce::FileChooser& c) {
+        auto f = c.getResult(); if (f != juce::File()) TraceRecorder::writeChromeTrace(f);
+    });
+}
+#endif
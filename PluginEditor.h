@@ -2,6 +2,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include <array>
 
 //==============================================================================
 class WaveformDisplay : public juce::Component
@@ -9,15 +10,27 @@ class WaveformDisplay : public juce::Component
 public:
     WaveformDisplay(GrainfreezeAudioProcessor& p) : processor(p) {}
     void paint(juce::Graphics& g) override;
+    void resized() override { waveformImage = {}; }
     void mouseDown(const juce::MouseEvent& event) override;
     void mouseDrag(const juce::MouseEvent& event) override;
     void mouseUp(const juce::MouseEvent& event) override;
 
+    /** Repaints only if something visible (markers, playheads, held notes) moved by at least a pixel. */
+    void refreshIfChanged();
+
 private:
     GrainfreezeAudioProcessor& processor;
     enum class DragMode { None, Playhead, LoopStart, LoopEnd };
     DragMode dragMode = DragMode::None;
     void updateFromMouse(const juce::MouseEvent& event);
+
+    // Static layer: the waveform itself, rebuilt on resize or when new audio is loaded
+    juce::Image waveformImage;
+    int waveformImageVersion = -1;
+    void renderWaveformImage();
+
+    juce::uint64 lastViewHash = 0;
+    juce::uint64 computeViewHash() const;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformDisplay)
 };
 
@@ -27,13 +40,24 @@ class SpectrumVisualizer : public juce::Component
 public:
     SpectrumVisualizer(GrainfreezeAudioProcessor& p) : processor(p) {}
     void paint(juce::Graphics& g) override;
+    void resized() override { backgroundImage = {}; barsImage = {}; barsDirty = true; }
     void updateSpectrum(const std::vector<float>& magnitudes, int fftSize, double sampleRate);
 
 private:
     GrainfreezeAudioProcessor& processor;
-    std::vector<float> noteMagnitudes;
     static const int numNotes = 88;
     static const int lowestNote = 21;
+    std::array<float, numNotes> noteMagnitudes{};
+    std::array<float, numNotes> binnedMagnitudes{};
+
+    // Static layer (background, octave grid, labels) and dynamic layer (bars, peak names)
+    juce::Image backgroundImage;
+    juce::Image barsImage;
+    bool barsDirty = true;
+    juce::Image createLayer(bool opaque) const;
+    void renderBackground();
+    void renderBars();
+
     int frequencyToMidiNote(float frequency);
     juce::String midiNoteToName(int midiNote);
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumVisualizer)
@@ -61,6 +85,18 @@ private:
     juce::TextButton freezeButton;
     juce::ToggleButton syncToDawButton;
     juce::TextButton midiModeButton;
+    juce::ToggleButton offlineQualityButton;
+    juce::ToggleButton liveInputButton;
+    juce::ToggleButton trueStereoButton;
+    juce::ToggleButton stereoLinkButton;
+    juce::ToggleButton phaseLockButton;
+    juce::ComboBox sampleStorageBox;
+    juce::ComboBox memoryBudgetBox;
+    juce::ComboBox sampleSlotBox;
+   #if GRAINFREEZE_TRACING
+    juce::TextButton saveTraceButton;
+    void saveTrace();
+   #endif
 
     juce::Label statusLabel;
     juce::Label recommendedLabel;
@@ -103,6 +139,7 @@ private:
 
     using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
     using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
 
     std::unique_ptr<SliderAttachment> timeStretchAttachment;
     std::unique_ptr<SliderAttachment> fftSizeAttachment;
@@ -121,8 +158,19 @@ private:
     std::unique_ptr<ButtonAttachment> freezeModeAttachment;
     std::unique_ptr<ButtonAttachment> syncToDawAttachment;
     std::unique_ptr<ButtonAttachment> midiModeAttachment;
+    std::unique_ptr<ButtonAttachment> offlineQualityAttachment;
+    std::unique_ptr<ButtonAttachment> liveInputAttachment;
+    std::unique_ptr<ButtonAttachment> trueStereoAttachment;
+    std::unique_ptr<ButtonAttachment> stereoLinkAttachment;
+    std::unique_ptr<ButtonAttachment> phaseLockAttachment;
+    std::unique_ptr<ComboBoxAttachment> sampleSlotAttachment;
 
     void loadAudioFile();
 
+    // Frame-rate governor: full rate while audio runs, a slow poll for parameter changes otherwise
+    static const int activeFrameRateHz = 30;
+    static const int idleFrameRateHz = 5;
+    int lastSpectrumVersion = -1;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrainfreezeAudioProcessorEditor)
 };
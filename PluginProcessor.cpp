@@ -10,18 +10,55 @@ GrainfreezeVoice::GrainfreezeVoice(GrainfreezeAudioProcessor& p) : processor(p)
     smoothedFreezePosition.reset(p.getCurrentSampleRate(), 0.1);
     envelope.reset(p.getCurrentSampleRate(), 0.05);
     random.setSeedRandomly();
-    allocateBuffers(65536);
 }
 
-void GrainfreezeVoice::allocateBuffers(int maxSize)
+GrainfreezeVoice::Buffers GrainfreezeVoice::createBuffers(int fftSize, bool withStereo)
 {
-    analysisFrame.assign(static_cast<size_t>(maxSize), 0.0f);
-    fftBuffer.assign(static_cast<size_t>(maxSize * 2), 0.0f);
-    magnitudeBuffer.assign(static_cast<size_t>(maxSize / 2 + 1), 0.0f);
-    phaseAdvanceBuffer.assign(static_cast<size_t>(maxSize / 2 + 1), 0.0f);
-    previousPhase.assign(static_cast<size_t>(maxSize / 2 + 1), 0.0f);
-    synthesisPhase.assign(static_cast<size_t>(maxSize / 2 + 1), 0.0f);
-    outputAccum.assign(static_cast<size_t>(maxSize * 8), 0.0f);
+    Buffers b;
+    b.fftSize = fftSize;
+    b.stereo = withStereo;
+    auto numBins = static_cast<size_t>(fftSize / 2 + 1);
+    b.analysisFrame.assign(static_cast<size_t>(fftSize), 0.0f);
+    b.fftBuffer.assign(static_cast<size_t>(fftSize * 2), 0.0f);
+    for (auto* v : { &b.magnitudeBuffer, &b.phaseAdvanceBuffer, &b.previousPhase, &b.synthesisPhase, &b.lockPhase })
+        v->assign(numBins, 0.0f);
+    b.lockPeaks.assign(numBins, 0);
+    b.lockOwner.assign(numBins, -1);
+    b.outputAccum.assign(static_cast<size_t>(fftSize * 8), 0.0f);
+    if (withStereo) {
+        b.stereoBuffer.assign(static_cast<size_t>(fftSize * 2), 0.0f);
+        b.outputAccumR.assign(static_cast<size_t>(fftSize * 8), 0.0f);
+        for (auto* v : { &b.previousPhaseR, &b.synthesisPhaseR, &b.magnitudeBufferR, &b.phaseAdvanceBufferR, &b.stereoPhaseDiff })
+            v->assign(numBins, 0.0f);
+    }
+    return b;
+}
+
+void GrainfreezeVoice::adoptBuffers(Buffers& b) noexcept
+{
+    jassert(b.fftSize >= allocatedFftSize && (b.stereo || !stereoAllocated));
+    analysisFrame.swap(b.analysisFrame);
+    fftBuffer.swap(b.fftBuffer);
+    magnitudeBuffer.swap(b.magnitudeBuffer);
+    phaseAdvanceBuffer.swap(b.phaseAdvanceBuffer);
+    previousPhase.swap(b.previousPhase);
+    synthesisPhase.swap(b.synthesisPhase);
+    lockPeaks.swap(b.lockPeaks);
+    lockOwner.swap(b.lockOwner);
+    lockPhase.swap(b.lockPhase);
+    outputAccum.swap(b.outputAccum);
+    if (b.stereo) {
+        stereoBuffer.swap(b.stereoBuffer);
+        outputAccumR.swap(b.outputAccumR);
+        previousPhaseR.swap(b.previousPhaseR);
+        synthesisPhaseR.swap(b.synthesisPhaseR);
+        magnitudeBufferR.swap(b.magnitudeBufferR);
+        phaseAdvanceBufferR.swap(b.phaseAdvanceBufferR);
+        stereoPhaseDiff.swap(b.stereoPhaseDiff);
+    }
+    allocatedFftSize = b.fftSize;
+    stereoAllocated = b.stereo;
+    outputWritePos = 0;
 }
 
 bool GrainfreezeVoice::canPlaySound(juce::SynthesiserSound* sound)
@@ -39,7 +76,7 @@ void GrainfreezeVoice::startNote(int midiNoteNumber, float velocity, juce::Synth
     envelope.setCurrentAndTargetValue(0.0f);
     envelope.setTargetValue(1.0f);
     
-    double numSamplesInAudio = static_cast<double>(processor.getLoadedAudio().getNumSamples());
+    double numSamplesInAudio = static_cast<double>(processor.getAnalysisSource().getNumSamples());
     float startPos = processor.midiStartPosParam->get();
     float endPos = processor.midiEndPosParam->get();
     float pos = juce::jmap(static_cast<float>(midiNoteNumber), 0.0f, 127.0f, startPos, endPos);
@@ -54,9 +91,14 @@ void GrainfreezeVoice::startNote(int midiNoteNumber, float velocity, juce::Synth
     
     std::fill(previousPhase.begin(), previousPhase.end(), 0.0f);
     std::fill(synthesisPhase.begin(), synthesisPhase.end(), 0.0f);
+    frameReadPos = -1;
     std::fill(outputAccum.begin(), outputAccum.end(), 0.0f);
+    std::fill(previousPhaseR.begin(), previousPhaseR.end(), 0.0f);
+    std::fill(synthesisPhaseR.begin(), synthesisPhaseR.end(), 0.0f);
+    std::fill(outputAccumR.begin(), outputAccumR.end(), 0.0f);
     outputWritePos = 0;
     grainCounter = 0;
+    laneNeedsReset = true;
 }
 
 void GrainfreezeVoice::stopNote(float /*velocity*/, bool allowTailOff)
@@ -72,25 +114,23 @@ void GrainfreezeVoice::stopNote(float /*velocity*/, bool allowTailOff)
 
 void GrainfreezeVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
 {
-    if (!processor.isAudioLoaded()) return;
-
-    double numSamplesInAudio = static_cast<double>(processor.getLoadedAudio().getNumSamples());
+    GF_TRACE_SCOPE("renderNextBlock");
+    // The analysis source is the capture ring in live mode, so a loaded file is not required
+    double numSamplesInAudio = static_cast<double>(processor.getAnalysisSource().getNumSamples());
+    if (numSamplesInAudio <= 0.0) return;
     double startLim = static_cast<double>(processor.loopStartParam->get()) * numSamplesInAudio;
     double endLim = static_cast<double>(processor.loopEndParam->get()) * numSamplesInAudio;
     if (startLim >= endLim) startLim = std::max(0.0, endLim - 1.0);
 
     int fftSize = processor.getCurrentFftSize();
-    int currentHopSize = std::max(1, fftSize / static_cast<int>(processor.hopSizeParam->get()));
+    int currentHopSize = processor.getCurrentHopSize();
 
-    if (currentVoiceFftSize != fftSize) {
-        currentVoiceFftSize = fftSize;
-        int order = 0; int t = fftSize; while (t > 1) { t >>= 1; order++; }
-        fftAnalysis = std::make_unique<juce::dsp::FFT>(order);
-        fftSynthesis = std::make_unique<juce::dsp::FFT>(order);
-    }
+    prepareFft(fftSize);
+    if (processor.isTrueStereoActive() != stereoOutput) setStereoOutput(processor.isTrueStereoActive());
 
     bool isMidiMode = processor.midiModeParam->get();
     bool isFreeze = processor.freezeModeParam->get();
+    bool isLive = processor.isLiveInputActive() && !isMidiMode && !isFreeze;
     float speed = 1.0f / std::max(0.1f, processor.timeStretch->get());
 
     if (isMidiMode) {
@@ -104,7 +144,10 @@ void GrainfreezeVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, i
         float gain = envelope.getNextValue();
         if (isStopping && gain <= 0.001f) { clearCurrentNote(); break; }
 
-        if (isMidiMode || isFreeze) {
+        if (isLive) {
+            // Track the input as it arrives so a freeze can start from the newest frame
+            playbackPosition = processor.getLiveFramePosition(startSample + sIdx);
+        } else if (isMidiMode || isFreeze) {
             if (!isMidiMode) smoothedFreezePosition.setTargetValue(juce::jlimit(startLim, endLim, static_cast<double>(processor.getPlayheadPosition()) * numSamplesInAudio));
             freezeCurrentPosition = smoothedFreezePosition.getNextValue();
             freezeMicroCounter++;
@@ -119,84 +162,336 @@ void GrainfreezeVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, i
             if (playbackPosition < startLim) playbackPosition = startLim;
         }
 
-        if (grainCounter <= 0) { performPhaseVocoder(); grainCounter = currentHopSize; }
+        if (!framesDrivenExternally && grainCounter <= 0) { frameSample = startSample + sIdx; performPhaseVocoder(); grainCounter = currentHopSize; }
 
-        float outS = 0.0f;
+        float outL = 0.0f, outR = 0.0f;
         if (outputWritePos < static_cast<int>(outputAccum.size())) {
-            outS = outputAccum[static_cast<size_t>(outputWritePos)] * currentVelocity * gain;
+            outL = outR = outputAccum[static_cast<size_t>(outputWritePos)] * currentVelocity * gain;
             outputAccum[static_cast<size_t>(outputWritePos)] = 0.0f;
+            if (stereoOutput) {
+                outR = outputAccumR[static_cast<size_t>(outputWritePos)] * currentVelocity * gain;
+                outputAccumR[static_cast<size_t>(outputWritePos)] = 0.0f;
+            }
         }
         for (int ch = 0; ch < outputBuffer.getNumChannels(); ++ch)
-            outputBuffer.addSample(ch, startSample + sIdx, outS);
+            outputBuffer.addSample(ch, startSample + sIdx, ch == 0 ? outL : outR);
 
         outputWritePos = (outputWritePos + 1) % static_cast<int>(outputAccum.size());
         grainCounter--;
     }
 }
 
+void GrainfreezeVoice::prepareFft(int fftSize)
+{
+    if (currentVoiceFftSize == fftSize) return;
+    jassert(fftSize <= allocatedFftSize);
+    currentVoiceFftSize = fftSize;
+    fft = processor.getFft();
+}
+
+void GrainfreezeVoice::setStereoOutput(bool shouldBeStereo)
+{
+    jassert(!shouldBeStereo || stereoAllocated);
+    // Hand the pending overlap-add tail and phase tracks over so switching does not click
+    if (shouldBeStereo) {
+        std::copy(outputAccum.begin(), outputAccum.end(), outputAccumR.begin());
+        std::copy(previousPhase.begin(), previousPhase.end(), previousPhaseR.begin());
+        std::copy(synthesisPhase.begin(), synthesisPhase.end(), synthesisPhaseR.begin());
+    } else if (stereoAllocated) {
+        juce::FloatVectorOperations::add(outputAccum.data(), outputAccumR.data(), static_cast<int>(outputAccum.size()));
+        juce::FloatVectorOperations::multiply(outputAccum.data(), 0.5f, static_cast<int>(outputAccum.size()));
+        std::fill(outputAccumR.begin(), outputAccumR.end(), 0.0f);
+    }
+    stereoOutput = shouldBeStereo;
+}
+
 void GrainfreezeVoice::performPhaseVocoder()
 {
-    const auto& audio = processor.getLoadedAudio();
-    int fftSize = currentVoiceFftSize;
-    int hopSize = std::max(1, fftSize / static_cast<int>(processor.hopSizeParam->get()));
-    int numBins = fftSize / 2 + 1;
-    int readPos = juce::jlimit(0, audio.getNumSamples() - fftSize, static_cast<int>(playbackPosition));
-    const auto& win = processor.getWindow();
-    const float* src = audio.getReadPointer(0);
-    bool isSt = audio.getNumChannels() > 1;
-    const float* srcR = isSt ? audio.getReadPointer(1) : nullptr;
+    if (stereoOutput) { performStereoPhaseVocoder(); return; }
 
-    for (int i = 0; i < fftSize; ++i) {
-        int idx = readPos + i;
-        float s = (idx < audio.getNumSamples()) ? src[idx] : 0.0f;
-        if (isSt && srcR && idx < audio.getNumSamples()) s = (s + srcR[idx]) * 0.5f;
-        analysisFrame[static_cast<size_t>(i)] = s * win[static_cast<size_t>(i)];
+    GF_TRACE_SCOPE("performPhaseVocoder");
+    analyseFrame();
+
+    {
+        GF_TRACE_SCOPE("pv.spectral");
+        int fftSize = currentVoiceFftSize;
+        int hopSize = processor.getCurrentHopSize();
+        int numBins = fftSize / 2 + 1;
+        float expPhaseAdv = juce::MathConstants<float>::twoPi * static_cast<float>(hopSize) / static_cast<float>(fftSize);
+        for (int bin = 0; bin < numBins; ++bin) {
+            float r = fftBuffer[static_cast<size_t>(bin * 2)], im = fftBuffer[static_cast<size_t>(bin * 2 + 1)];
+            float mag = std::sqrt(r * r + im * im), ph = std::atan2(im, r);
+            float d = (ph - previousPhase[static_cast<size_t>(bin)]) - (static_cast<float>(bin) * expPhaseAdv);
+            previousPhase[static_cast<size_t>(bin)] = ph;
+            d = std::fmod(d + juce::MathConstants<float>::pi, juce::MathConstants<float>::twoPi);
+            if (d < 0) d += juce::MathConstants<float>::twoPi;
+            magnitudeBuffer[static_cast<size_t>(bin)] = mag;
+            phaseAdvanceBuffer[static_cast<size_t>(bin)] = (static_cast<float>(bin) * expPhaseAdv) + (d - juce::MathConstants<float>::pi);
+        }
+
+        float pf = std::pow(2.0f, processor.pitchShiftParam->get() / 12.0f);
+        auto interpolate = [](const std::vector<float>& v, float srcBin) {
+            auto bL = static_cast<size_t>(srcBin); float wU = srcBin - static_cast<float>(bL);
+            return (v[bL] * (1.0f - wU)) + (v[bL + 1] * wU);
+        };
+        auto wrap = [](float x) {
+            x = std::fmod(x + juce::MathConstants<float>::pi, juce::MathConstants<float>::twoPi);
+            if (x < 0) x += juce::MathConstants<float>::twoPi;
+            return x - juce::MathConstants<float>::pi;
+        };
+
+        // Identity phase locking (Laroche & Dolson). The per-bin advance above is the analysed phase
+        // difference, which ignores how far the read position actually moved, so frames at a new
+        // position land with unrelated phases. Here each spectral peak advances by its estimated
+        // frequency times the synthesis hop, and every other bin keeps its analysed phase offset
+        // from the peak it belongs to, so each partial stays coherent across frames.
+        const bool locked = processor.phaseLockParam->get();
+        const int numPeaks = locked ? findSpectralPeaks(numBins) : 0;
+        const int analysisHop = frameReadPos - previousFrameReadPos;
+        const bool hopUsable = previousFrameReadPos >= 0 && analysisHop != 0 && std::abs(analysisHop) <= fftSize / 4;
+        for (int i = 0; i < numPeaks; ++i) {
+            int peak = lockPeaks[static_cast<size_t>(i)];
+            float binFreq = juce::MathConstants<float>::twoPi * static_cast<float>(peak) / static_cast<float>(fftSize);
+            float freq;   // radians per sample
+            if (hopUsable) {
+                // Phase difference over the hop the read position really moved (unambiguous within the main lobe)
+                float hop = static_cast<float>(analysisHop);
+                freq = binFreq + wrap(phaseAdvanceBuffer[static_cast<size_t>(peak)] - binFreq * hop) / hop;
+            } else {
+                // Frozen, jumped or first frame: parabolic fit to the log magnitudes around the peak
+                float a = std::log(magnitudeBuffer[static_cast<size_t>(peak - 1)] + 1.0e-12f), b = std::log(magnitudeBuffer[static_cast<size_t>(peak)] + 1.0e-12f), c = std::log(magnitudeBuffer[static_cast<size_t>(peak + 1)] + 1.0e-12f);
+                float den = a - 2.0f * b + c;
+                freq = binFreq + (den < 0.0f ? 0.5f * (a - c) / den : 0.0f) * juce::MathConstants<float>::twoPi / static_cast<float>(fftSize);
+            }
+            int target = juce::jmin(juce::roundToInt(static_cast<float>(peak) * pf), numBins - 1);
+            lockPhase[static_cast<size_t>(peak)] = wrap(synthesisPhase[static_cast<size_t>(target)] + freq * pf * static_cast<float>(hopSize));
+        }
+
+        std::fill(fftBuffer.begin(), fftBuffer.begin() + fftSize * 2, 0.0f);
+        for (int bin = 0; bin < numBins; ++bin) {
+            float srcBin = static_cast<float>(bin) / pf;
+            float mag = 0.0f, phAdv = 0.0f;
+            int owner = -1, nearest = 0;
+            if (srcBin < static_cast<float>(numBins - 1)) {
+                mag = interpolate(magnitudeBuffer, srcBin);
+                phAdv = interpolate(phaseAdvanceBuffer, srcBin) * pf;
+                nearest = juce::roundToInt(srcBin);
+                if (numPeaks > 0) owner = lockOwner[static_cast<size_t>(nearest)];
+            }
+            mag *= (1.0f + (static_cast<float>(bin) / static_cast<float>(numBins - 1) * (processor.hfBoostParam->get() / 100.0f)));
+            processor.updateVoiceSpectrum(bin, mag);
+            auto& phase = synthesisPhase[static_cast<size_t>(bin)];
+            if (owner >= 0) phase = wrap(lockPhase[static_cast<size_t>(owner)] + previousPhase[static_cast<size_t>(nearest)] - previousPhase[static_cast<size_t>(owner)]);
+            else phase = wrap(phase + phAdv);
+            fftBuffer[static_cast<size_t>(bin * 2)] = mag * std::cos(phase);
+            fftBuffer[static_cast<size_t>(bin * 2 + 1)] = mag * std::sin(phase);
+        }
+    }
+
+    synthesiseFrame();
+}
+
+int GrainfreezeVoice::findSpectralPeaks(int numBins)
+{
+    // A peak is louder than the two bins on either side; each bin belongs to its nearest peak
+    const float* m = magnitudeBuffer.data();
+    int numPeaks = 0;
+    for (int k = 1; k < numBins - 1; ++k) {
+        float v = m[k];
+        if (v > m[k - 1] && v >= m[k + 1] && (k < 2 || v > m[k - 2]) && (k + 2 >= numBins || v >= m[k + 2]) && v > 0.0f)
+            lockPeaks[static_cast<size_t>(numPeaks++)] = k;
+    }
+    if (numPeaks == 0) return 0;
+    for (int k = 0, j = 0; k < numBins; ++k) {
+        while (j + 1 < numPeaks && lockPeaks[static_cast<size_t>(j + 1)] - k < k - lockPeaks[static_cast<size_t>(j)]) ++j;
+        lockOwner[static_cast<size_t>(k)] = lockPeaks[static_cast<size_t>(j)];
+    }
+    return numPeaks;
+}
+
+void GrainfreezeVoice::performStereoPhaseVocoder()
+{
+    GF_TRACE_SCOPE("performStereoPhaseVocoder");
+    constexpr float pi = juce::MathConstants<float>::pi, twoPi = juce::MathConstants<float>::twoPi;
+    auto wrap = [](float x) { x = std::fmod(x + pi, twoPi); if (x < 0) x += twoPi; return x - pi; };
+
+    auto source = processor.getAnalysisSource(frameSample);
+    const auto& windows = processor.getWindows();
+    const int fftSize = currentVoiceFftSize;
+    const int numBins = fftSize / 2 + 1;
+    int readPos = juce::jlimit(0, juce::jmax(0, source.getNumSamples() - fftSize), static_cast<int>(playbackPosition));
+    float* packed = stereoBuffer.data();
+    float* spectrum = fftBuffer.data();
+
+    {
+        GF_TRACE_SCOPE("pv.window");
+        source.readStereo(packed, readPos, fftSize);   // left + i * right
+        for (int i = 0; i < fftSize; ++i) { packed[2 * i] *= windows.analysis[i]; packed[2 * i + 1] *= windows.analysis[i]; }
     }
 
-    std::copy(analysisFrame.begin(), analysisFrame.begin() + fftSize, fftBuffer.begin());
-    fftAnalysis->performRealOnlyForwardTransform(fftBuffer.data(), true);
-
-    float expPhaseAdv = juce::MathConstants<float>::twoPi * static_cast<float>(hopSize) / static_cast<float>(fftSize);
-    for (int bin = 0; bin < numBins; ++bin) {
-        float r = fftBuffer[static_cast<size_t>(bin * 2)], im = fftBuffer[static_cast<size_t>(bin * 2 + 1)];
-        float mag = std::sqrt(r * r + im * im), ph = std::atan2(im, r);
-        float d = (ph - previousPhase[static_cast<size_t>(bin)]) - (static_cast<float>(bin) * expPhaseAdv);
-        previousPhase[static_cast<size_t>(bin)] = ph;
-        d = std::fmod(d + juce::MathConstants<float>::pi, juce::MathConstants<float>::twoPi);
-        if (d < 0) d += juce::MathConstants<float>::twoPi;
-        magnitudeBuffer[static_cast<size_t>(bin)] = mag;
-        phaseAdvanceBuffer[static_cast<size_t>(bin)] = (static_cast<float>(bin) * expPhaseAdv) + (d - juce::MathConstants<float>::pi);
+    {
+        GF_TRACE_SCOPE("pv.forwardFft");
+        fft->performComplex(packed, spectrum, false);
     }
 
-    float pf = std::pow(2.0f, processor.pitchShiftParam->get() / 12.0f);
-    std::fill(fftBuffer.begin(), fftBuffer.begin() + fftSize * 2, 0.0f);
-    for (int bin = 0; bin < numBins; ++bin) {
-        float srcBin = static_cast<float>(bin) / pf;
-        float mag = 0.0f, phAdv = 0.0f;
-        if (srcBin < static_cast<float>(numBins - 1)) {
-            int bL = static_cast<int>(srcBin); float wU = srcBin - static_cast<float>(bL);
-            mag = (magnitudeBuffer[static_cast<size_t>(bL)] * (1.0f - wU)) + (magnitudeBuffer[static_cast<size_t>(bL + 1)] * wU);
-            phAdv = (phaseAdvanceBuffer[static_cast<size_t>(bL)] * (1.0f - wU)) + (phaseAdvanceBuffer[static_cast<size_t>(bL + 1)] * wU);
-            phAdv *= pf;
+    {
+        GF_TRACE_SCOPE("pv.spectral");
+        const bool linked = processor.stereoLinkParam->get();
+        float expPhaseAdv = twoPi * static_cast<float>(processor.getCurrentHopSize()) / static_cast<float>(fftSize);
+        for (int bin = 0; bin < numBins; ++bin) {
+            // Separate the channels: L = (Z[k] + conj Z[N-k]) / 2, R = (Z[k] - conj Z[N-k]) / 2i
+            const float* z = spectrum + 2 * bin;
+            const float* c = spectrum + 2 * ((fftSize - bin) & (fftSize - 1));
+            float lr = 0.5f * (z[0] + c[0]), li = 0.5f * (z[1] - c[1]);
+            float rr = 0.5f * (z[1] + c[1]), ri = 0.5f * (c[0] - z[0]);
+
+            auto b = static_cast<size_t>(bin);
+            float phL = std::atan2(li, lr), phR = std::atan2(ri, rr);
+            float expected = static_cast<float>(bin) * expPhaseAdv;
+            float advL = expected + wrap(phL - previousPhase[b] - expected);
+            float advR = expected + wrap(phR - previousPhaseR[b] - expected);
+            previousPhase[b] = phL; previousPhaseR[b] = phR;
+            magnitudeBuffer[b] = std::sqrt(lr * lr + li * li);
+            magnitudeBufferR[b] = std::sqrt(rr * rr + ri * ri);
+
+            // Linked: both channels follow the louder channel's phase advance, and the
+            // right channel keeps its analysed offset from the left (stable image)
+            if (linked) advL = advR = magnitudeBuffer[b] >= magnitudeBufferR[b] ? advL : advR;
+            phaseAdvanceBuffer[b] = advL;
+            phaseAdvanceBufferR[b] = advR;
+            stereoPhaseDiff[b] = phR - phL;
         }
-        mag *= (1.0f + (static_cast<float>(bin) / static_cast<float>(numBins - 1) * (processor.hfBoostParam->get() / 100.0f)));
-        processor.updateVoiceSpectrum(bin, mag);
-        synthesisPhase[static_cast<size_t>(bin)] += phAdv;
-        synthesisPhase[static_cast<size_t>(bin)] = std::fmod(synthesisPhase[static_cast<size_t>(bin)] + juce::MathConstants<float>::pi, juce::MathConstants<float>::twoPi);
-        if (synthesisPhase[static_cast<size_t>(bin)] < 0) synthesisPhase[static_cast<size_t>(bin)] += juce::MathConstants<float>::twoPi;
-        synthesisPhase[static_cast<size_t>(bin)] -= juce::MathConstants<float>::pi;
-        fftBuffer[static_cast<size_t>(bin * 2)] = mag * std::cos(synthesisPhase[static_cast<size_t>(bin)]);
-        fftBuffer[static_cast<size_t>(bin * 2 + 1)] = mag * std::sin(synthesisPhase[static_cast<size_t>(bin)]);
+
+        float pf = std::pow(2.0f, processor.pitchShiftParam->get() / 12.0f);
+        float boost = processor.hfBoostParam->get() / 100.0f;
+        for (int bin = 0; bin < numBins; ++bin) {
+            float srcBin = static_cast<float>(bin) / pf;
+            float magL = 0.0f, magR = 0.0f, advL = 0.0f, advR = 0.0f, diff = 0.0f;
+            if (srcBin < static_cast<float>(numBins - 1)) {
+                auto bL = static_cast<size_t>(srcBin); float wU = srcBin - static_cast<float>(bL);
+                magL = magnitudeBuffer[bL] * (1.0f - wU) + magnitudeBuffer[bL + 1] * wU;
+                magR = magnitudeBufferR[bL] * (1.0f - wU) + magnitudeBufferR[bL + 1] * wU;
+                advL = (phaseAdvanceBuffer[bL] * (1.0f - wU) + phaseAdvanceBuffer[bL + 1] * wU) * pf;
+                advR = (phaseAdvanceBufferR[bL] * (1.0f - wU) + phaseAdvanceBufferR[bL + 1] * wU) * pf;
+                diff = stereoPhaseDiff[wU < 0.5f ? bL : bL + 1];
+            }
+            float gain = 1.0f + (static_cast<float>(bin) / static_cast<float>(numBins - 1) * boost);
+            magL *= gain; magR *= gain;
+            processor.updateVoiceSpectrum(bin, juce::jmax(magL, magR));
+
+            auto b = static_cast<size_t>(bin);
+            synthesisPhase[b] = wrap(synthesisPhase[b] + advL);
+            synthesisPhaseR[b] = linked ? wrap(synthesisPhase[b] + diff) : wrap(synthesisPhaseR[b] + advR);
+
+            // Pack SL + i * SR for the inverse, using the Hermitian symmetry of each channel.
+            // DC and Nyquist stay real, as the real-only inverse would treat them.
+            float slr = magL * std::cos(synthesisPhase[b]), sli = magL * std::sin(synthesisPhase[b]);
+            float srr = magR * std::cos(synthesisPhaseR[b]), sri = magR * std::sin(synthesisPhaseR[b]);
+            bool edge = bin == 0 || bin == numBins - 1;
+            if (edge) sli = sri = 0.0f;
+            packed[2 * bin] = slr - sri; packed[2 * bin + 1] = sli + srr;
+            if (!edge) { int m = fftSize - bin; packed[2 * m] = slr + sri; packed[2 * m + 1] = srr - sli; }
+        }
+    }
+
+    {
+        GF_TRACE_SCOPE("pv.inverseFft");
+        fft->performComplex(packed, spectrum, true);
+    }
+
+    GF_TRACE_SCOPE("pv.overlapAdd");
+    const float* win = windows.synthesis;
+    for (int i = 0; i < fftSize; ++i) {
+        auto outIdx = static_cast<size_t>((outputWritePos + i) % static_cast<int>(outputAccum.size()));
+        outputAccum[outIdx] += spectrum[2 * i] * win[i];
+        outputAccumR[outIdx] += spectrum[2 * i + 1] * win[i];
+    }
+}
+
+void GrainfreezeVoice::analyseFrame()
+{
+    auto source = processor.getAnalysisSource(frameSample);
+    int fftSize = currentVoiceFftSize;
+    int readPos = juce::jlimit(0, juce::jmax(0, source.getNumSamples() - fftSize), static_cast<int>(playbackPosition));
+    previousFrameReadPos = frameReadPos;
+    frameReadPos = readPos;
+
+    {
+        GF_TRACE_SCOPE("pv.window");
+        source.readMono(analysisFrame.data(), readPos, fftSize);
+        juce::FloatVectorOperations::multiply(analysisFrame.data(), processor.getWindows().analysis, fftSize);
+    }
+
+    {
+        GF_TRACE_SCOPE("pv.forwardFft");
+        std::copy(analysisFrame.begin(), analysisFrame.begin() + fftSize, fftBuffer.begin());
+        fft->performRealOnlyForwardTransform(fftBuffer.data(), true);
+    }
+}
+
+void GrainfreezeVoice::synthesiseFrame()
+{
+    int fftSize = currentVoiceFftSize;
+    const float* win = processor.getWindows().synthesis;   // overlap-add normalisation folded in
+
+    {
+        GF_TRACE_SCOPE("pv.inverseFft");
+        fft->performRealOnlyInverseTransform(fftBuffer.data());
     }
 
-    fftSynthesis->performRealOnlyInverseTransform(fftBuffer.data());
-    float norm = 2.0f / (static_cast<float>(fftSize) / static_cast<float>(hopSize));
+    GF_TRACE_SCOPE("pv.overlapAdd");
     for (int i = 0; i < fftSize; ++i) {
         int outIdx = (outputWritePos + i) % static_cast<int>(outputAccum.size());
-        outputAccum[static_cast<size_t>(outIdx)] += fftBuffer[static_cast<size_t>(i)] * win[static_cast<size_t>(i)] * norm;
+        outputAccum[static_cast<size_t>(outIdx)] += fftBuffer[static_cast<size_t>(i)] * win[i];
     }
 }
 
+//==============================================================================
+// GrainfreezeSynthesiser Implementation
+//==============================================================================
+
+void GrainfreezeSynthesiser::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    bool batched = batchingEnabled && !offline && batchEngine.isApplicable(voices.size());
+    for (auto* v : voices) static_cast<GrainfreezeVoice*>(v)->framesDrivenExternally = batched;
+    if (batched) { batchEngine.render(voices, outputAudio, startSample, numSamples); return; }
+
+    juce::Array<juce::SynthesiserVoice*> active;
+    if (offline)
+        for (auto* v : voices) if (v->isVoiceActive()) active.add(v);
+
+    if (active.size() < 2) { juce::Synthesiser::renderVoices(outputAudio, startSample, numSamples); return; }
+
+    // Offline only: real-time constraints do not apply, so allocating here is fine.
+    if (renderPool == nullptr) renderPool = std::make_unique<juce::ThreadPool>(juce::jmax(1, juce::SystemStats::getNumCpus()));
+    while (voiceBuffers.size() < active.size()) voiceBuffers.add(new juce::AudioBuffer<float>());
+
+    std::atomic<int> remaining{ active.size() };
+    juce::WaitableEvent allDone;
+    for (int i = 0; i < active.size(); ++i) {
+        auto* v = active.getUnchecked(i);
+        auto* vb = voiceBuffers.getUnchecked(i);
+        vb->setSize(outputAudio.getNumChannels(), numSamples, false, false, true);
+        vb->clear();
+        renderPool->addJob([v, vb, numSamples, &remaining, &allDone] {
+            { GF_TRACE_THREAD("Offline render worker"); v->renderNextBlock(*vb, 0, numSamples); }
+            if (--remaining == 0) allDone.signal();
+            return juce::ThreadPoolJob::jobHasFinished;
+        });
+    }
+    allDone.wait();
+
+    for (int i = 0; i < active.size(); ++i)
+        for (int ch = 0; ch < outputAudio.getNumChannels(); ++ch)
+            outputAudio.addFrom(ch, startSample, *voiceBuffers.getUnchecked(i), ch, 0, numSamples);
+}
+
+void GrainfreezeSynthesiser::releaseOfflineResources()
+{
+    renderPool.reset();
+    voiceBuffers.clear();
+}
+
 //==============================================================================
 // Audio Processor Implementation
 //==============================================================================
@@ -228,13 +523,39 @@ juce::AudioProcessorValueTreeState::ParameterLayout GrainfreezeAudioProcessor::c
     // Envelope Parameters
     layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("attack", 1), "Attack", juce::NormalisableRange<float>(1.0f, 2000.0f, 1.0f, 0.3f), 50.0f));
     layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("release", 1), "Release", juce::NormalisableRange<float>(1.0f, 5000.0f, 1.0f, 0.3f), 500.0f));
+
+    // Offline bounce: one FFT size up and twice the overlap when the host renders non-realtime
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("offlineQuality", 1), "HQ Offline Render", false));
+
+    // Resynthesise the input bus instead of the loaded file; Freeze holds the newest frame
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("liveInput", 1), "Live Input", false));
+
+    // Stereo sources: vocode left and right (packed into one complex FFT) instead of the mono downmix.
+    // Stereo Link shares the phase advance so the image stays coherent.
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("trueStereo", 1), "True Stereo", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("stereoLink", 1), "Stereo Link", true));
+
+    // Identity phase locking around spectral peaks: less phasiness, so smaller FFT sizes sound clean
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("phaseLock", 1), "Phase Lock", false));
+
+    // Which sample slot is analysed; MIDI program change selects slots too
+    juce::StringArray slotNames;
+    for (int i = 0; i < SampleLibrary::numSlots; ++i) slotNames.add("Slot " + juce::String(i + 1));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("sampleSlot", 1), "Sample Slot", slotNames, 0));
+
+    // Where playback actually is, for host displays: an output meter, so hosts show it read-only and never record it
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("playheadReadout", 1), "Playhead Readout", juce::NormalisableRange<float>(0.0f, 1.0f, 0.0001f), 0.0f,
+                                                           juce::AudioParameterFloatAttributes().withAutomatable(false).withCategory(juce::AudioProcessorParameter::outputMeter)));
     
     return layout;
 }
 
 GrainfreezeAudioProcessor::GrainfreezeAudioProcessor()
-    : AudioProcessor(BusesProperties().withOutput("Output", juce::AudioChannelSet::stereo(), true)),
-      apvts(*this, nullptr, "PARAMETERS", createParameterLayout())
+    : AudioProcessor(BusesProperties().withInput("Input", juce::AudioChannelSet::stereo(), true)
+                                      .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
+      apvts(*this, nullptr, "PARAMETERS", createParameterLayout()),
+      synth(*this),
+      sampleLibrary(*sampleCache)
 {
     timeStretch = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("timeStretch"));
     grainSizeParam = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("grainSize"));
@@ -256,45 +577,95 @@ GrainfreezeAudioProcessor::GrainfreezeAudioProcessor()
     midiEndPosParam = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("midiEndPos"));
     attackParam = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("attack"));
     releaseParam = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("release"));
+    offlineQualityParam = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("offlineQuality"));
+    liveInputParam = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("liveInput"));
+    trueStereoParam = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("trueStereo"));
+    stereoLinkParam = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("stereoLink"));
+    phaseLockParam = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("phaseLock"));
+    sampleSlotParam = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("sampleSlot"));
+    playheadReadoutParam = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("playheadReadout"));
 
     lastPlayheadParam = playheadPosParam->get();
-    
-    int sizes[] = { 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536 };
-    for (int i = 0; i < numFftSizes; ++i) {
-        int order = 0; int t = sizes[i]; while (t > 1) { t >>= 1; order++; }
-        analysisFftObjects[i] = std::make_unique<juce::dsp::FFT>(order);
-        synthesisFftObjects[i] = std::make_unique<juce::dsp::FFT>(order);
-    }
 
+    // FFTs and voice buffers are created on demand in prepareToPlay, so constructing
+    // an instance (e.g. during a host plugin scan) stays cheap.
     for (int i = 0; i < 16; ++i) synth.addVoice(new GrainfreezeVoice(*this));
     synth.addSound(new GrainfreezeSound());
     for (int i = 0; i < 128; ++i) midiNoteStates[i].store(0.0f);
+    startTimerHz(requestPollHz);
 }
 
-GrainfreezeAudioProcessor::~GrainfreezeAudioProcessor() {}
+GrainfreezeAudioProcessor::~GrainfreezeAudioProcessor()
+{
+    stopTimer();
+   #if GRAINFREEZE_RT_CHECK
+    if (RealtimeCheck::getNumViolations() > 0)
+        juce::Logger::writeToLog("Real-time safety violations in processBlock:\n" + RealtimeCheck::getReport());
+   #endif
+}
 const juce::String GrainfreezeAudioProcessor::getName() const { return JucePlugin_Name; }
 
 void GrainfreezeAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     juce::ignoreUnused(samplesPerBlock);
+   #if GRAINFREEZE_TRACING
+    TraceRecorder::reserveRings(1 + juce::SystemStats::getNumCpus());   // audio thread + offline render workers
+   #endif
     currentSampleRate = sampleRate;
     synth.setCurrentPlaybackSampleRate(sampleRate);
     smoothedFreezePosition.reset(sampleRate, static_cast<double>(glideParam->get()) / 1000.0);
-    updateGlobalFftSettings();
+    int fftSizeIndex = getFftSizeIndex();
+    int windowType = windowTypeParam->getIndex();
+    float hopDivisor = getHopDivisor();
+    applyRenderSettings(fftSizeIndex, windowType, hopDivisor, prepareRenderResources(fftSizeIndex, windowType, hopDivisor));
+
+    slotFadeLength = juce::jmax(1, juce::roundToInt(slotFadeSeconds * sampleRate));
+    captureLookBack = juce::roundToInt(captureSeconds * sampleRate);
+    if (getTotalNumInputChannels() > 0) captureRing.prepare(getTotalNumInputChannels(), captureLookBack + getFftSizeForIndex(numFftSizes - 1));
+    else captureRing.release();
+    liveActive = wasLiveFrozen = false;
 }
 
-void GrainfreezeAudioProcessor::releaseResources() {}
-bool GrainfreezeAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const { return layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo(); }
+void GrainfreezeAudioProcessor::releaseResources() { synth.releaseOfflineResources(); captureRing.release(); }
+
+bool GrainfreezeAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const {
+    auto in = layouts.getMainInputChannelSet();
+    bool inputOk = in.isDisabled() || in == juce::AudioChannelSet::mono() || in == juce::AudioChannelSet::stereo();
+    return inputOk && layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo();
+}
 
 void GrainfreezeAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    GF_REALTIME_SCOPE(!isNonRealtime());
+    GF_TRACE_SCOPE("processBlock");
+    const SampleLibrary::ReadScope sampleReadScope(sampleLibrary);
     juce::ScopedNoDenormals noDenormals;
+    const int numSamples = buffer.getNumSamples();
+    bool wasLiveActive = liveActive;
+    liveActive = liveInputParam->get() && captureRing.isPrepared();
+    if (liveActive && !wasLiveActive) captureRing.reset();   // don't replay what was captured before Live Input was last switched off
+    bool liveFrozen = liveActive && freezeModeParam->get();
+    if (liveActive && !liveFrozen) captureRing.write(buffer, getTotalNumInputChannels(), numSamples); // before the input is cleared
+    liveBlockStart = liveActive ? getAnalysisSource().getNumSamples() - numSamples : 0;
     buffer.clear();
-    if (!audioLoaded) return;
-
-    if (fftSizeParam->getIndex() != lastFftSizeIndex) { lastFftSizeIndex = fftSizeParam->getIndex(); updateGlobalFftSettings(); }
-    if (hopSizeParam->get() != lastHopSizeValue) { lastHopSizeValue = hopSizeParam->get(); updateGlobalHopSize(); }
-    if (windowTypeParam->getIndex() != lastWindowTypeIndex) { lastWindowTypeIndex = windowTypeParam->getIndex(); createWindow(); }
+    updateSampleSlot(midiMessages, numSamples);
+    if (playbackResetPending.exchange(false)) { playheadPosition.store(0.0f); playbackPosition = 0.0; synth.allNotesOff(0, false); playheadSyncRequested = true; }
+    sourceLength.store(getAnalysisSource().getNumSamples(), std::memory_order_relaxed);
+    if (!(getLoadedSource().getNumSamples() > 0 || liveActive)) return;
+
+    synth.setOfflineRendering(isNonRealtime());
+    int fftSizeIndex = getFftSizeIndex();
+    int windowType = windowTypeParam->getIndex();
+    float hopDivisor = getHopDivisor();
+    if (fftSizeIndex != lastFftSizeIndex || windowType != lastWindowTypeIndex || hopDivisor != lastHopSizeValue) {
+        auto* windows = isFftSizePrepared(fftSizeIndex) ? windowBank->find(fftSizeIndex, windowType, hopDivisor) : nullptr;
+        if (windows == nullptr && isNonRealtime()) windows = &prepareRenderResources(fftSizeIndex, windowType, hopDivisor);
+        if (windows != nullptr) applyRenderSettings(fftSizeIndex, windowType, hopDivisor, *windows);
+        else renderResourcesRequested = true; // keep the current settings until the message thread has prepared the new ones
+    }
+    bool wantStereo = trueStereoParam->get();
+    if (wantStereo && !preparedStereo) { if (isNonRealtime()) prepareVoiceBuffers(preparedFftSize, true); else renderResourcesRequested = true; }
+    trueStereoActive = wantStereo && preparedStereo && getAnalysisSource().getNumChannels() > 1;
 
     std::fill(spectrumMagnitudes.begin(), spectrumMagnitudes.end(), 0.0f);
 
@@ -306,38 +677,93 @@ void GrainfreezeAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, j
     }
 
     bool isMidi = midiModeParam->get();
-    static bool intWasMidi = false;
-    if (isMidi != intWasMidi) { synth.allNotesOff(0, false); for (int i = 0; i < 128; ++i) midiNoteStates[i].store(0.0f); intWasMidi = isMidi; }
+    if (isMidi != wasMidiMode) { synth.allNotesOff(0, false); for (int i = 0; i < 128; ++i) midiNoteStates[i].store(0.0f); wasMidiMode = isMidi; }
 
     if (isMidi) {
         synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
     } else {
         if (syncToDawParam->get()) if (auto* ph = getPlayHead()) if (auto posInfo = ph->getPosition()) if (posInfo->getIsPlaying() != playing) setPlaying(posInfo->getIsPlaying());
         float currentParam = playheadPosParam->get();
-        if (std::abs(currentParam - lastPlayheadParam) > 0.00001f) { setPlayheadPosition(currentParam); lastPlayheadParam = currentParam; }
+        float synced = playheadParamSync.load();
+        bool isSyncWrite = std::abs(currentParam - synced) <= 0.0001f;
+        if (isSyncWrite) playheadParamSync.compare_exchange_strong(synced, -1.0f);
+        if (std::abs(currentParam - lastPlayheadParam) > 0.00001f) { if (!isSyncWrite) setPlayheadPosition(currentParam); lastPlayheadParam = currentParam; }
         isInFreezeMode = freezeModeParam->get();
-        bool shouldActive = playing || isInFreezeMode;
+        bool shouldActive = playing || isInFreezeMode || liveActive;
         GrainfreezeVoice* v = getManualVoice();
+        if (v != nullptr && liveFrozen && !wasLiveFrozen) {
+            // Freeze the newest complete frame; the playhead can then scrub back through the captured history
+            int len = getAnalysisSource().getNumSamples();
+            double pos = static_cast<double>(juce::jmax(0, len - currentFftSize));
+            v->smoothedFreezePosition.setCurrentAndTargetValue(pos);
+            v->freezeCurrentPosition = pos;
+            playheadPosition.store(len > 0 ? static_cast<float>(pos / len) : 0.0f);
+            playheadSyncRequested = true;
+        }
         if (shouldActive && v == nullptr) synth.noteOn(1, 60, 1.0f);
         else if (!shouldActive && v != nullptr) synth.noteOff(1, 60, 1.0f, true);
         juce::MidiBuffer dummyMidi; synth.renderNextBlock(buffer, dummyMidi, 0, buffer.getNumSamples());
         if (v != nullptr) {
-            float np = static_cast<float>(v->freezeCurrentPosition / static_cast<double>(loadedAudio.getNumSamples()));
+            float np = static_cast<float>(v->freezeCurrentPosition / static_cast<double>(juce::jmax(1, getAnalysisSource().getNumSamples())));
             playheadPosition.store(np);
-            if (playing && !isInFreezeMode) { *playheadPosParam = np; lastPlayheadParam = np; }
-        } else lastPlayheadParam = playheadPosParam->get();
+        }
+    }
+    wasLiveFrozen = liveFrozen;
+    if (!playing && !liveActive) buffer.clear();
+    spectrumVersion.fetch_add(1, std::memory_order_release);
+}
+
+void GrainfreezeAudioProcessor::updateSampleSlot(const juce::MidiBuffer& midiMessages, int numSamples)
+{
+    int paramSlot = sampleSlotParam->getIndex();
+    if (paramSlot != lastSlotParam) { selectedSlot = paramSlot; lastSlotParam = paramSlot; }
+    for (const auto metadata : midiMessages) {
+        auto msg = metadata.getMessage();
+        if (msg.isProgramChange()) selectedSlot = msg.getProgramChangeNumber() % SampleLibrary::numSlots;
     }
-    if (!playing) buffer.clear();
+
+    if (slotFadeRemaining > 0 && (slotFadeRemaining = juce::jmax(0, slotFadeRemaining - numSamples)) == 0) fadeSlot = -1;
+    int active = activeSlot.load(std::memory_order_relaxed);
+    // Marked before any slot is read this block: a switch only ever moves between these three
+    sampleLibrary.setBusySlots(active, fadeSlot, selectedSlot != active ? selectedSlot : -1);
+    if (selectedSlot != active && slotFadeRemaining == 0) {   // one switch at a time
+        if (sampleLibrary.getSample(selectedSlot) != nullptr) {
+            fadeSlot = sampleLibrary.getSample(active) != nullptr ? active : -1;
+            slotFadeRemaining = fadeSlot >= 0 ? slotFadeLength : 0;
+            activeSlot.store(active = selectedSlot, std::memory_order_relaxed);
+            loadedAudioVersion.fetch_add(1, std::memory_order_release);
+        } else if (sampleLibrary.requestLoad(selectedSlot)) {
+            loaderWakeRequested = true; // the timer wakes the loader; keep playing the current slot meanwhile
+        }
+    }
+
+    auto* current = sampleLibrary.getSample(active);
+    loadedView = current != nullptr ? current->getView() : SampleSourceView();
+    auto* previous = fadeSlot >= 0 ? sampleLibrary.getSample(fadeSlot) : nullptr;
+    slotFadeView = previous != nullptr ? previous->getView() : SampleSourceView();
+}
+
+void GrainfreezeAudioProcessor::setRandomSeed(juce::int64 seed)
+{
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* v = dynamic_cast<GrainfreezeVoice*>(synth.getVoice(i))) v->setRandomSeed(seed + i);
 }
 
 void GrainfreezeAudioProcessor::updateVoiceSpectrum(int bin, float magnitude)
 {
+    if (synth.isRenderingOffline()) return; // voices may be rendering concurrently
     if (bin < (int)spectrumMagnitudes.size()) {
         float current = spectrumMagnitudes[static_cast<size_t>(bin)];
         if (magnitude > current) spectrumMagnitudes[static_cast<size_t>(bin)] = magnitude;
     }
 }
 
+bool GrainfreezeAudioProcessor::hasActiveVoices() const {
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (synth.getVoice(i)->isVoiceActive()) return true;
+    return false;
+}
+
 GrainfreezeVoice* GrainfreezeAudioProcessor::getManualVoice() {
     for (int i = 0; i < synth.getNumVoices(); ++i)
         if (auto* v = dynamic_cast<GrainfreezeVoice*>(synth.getVoice(i)))
@@ -345,45 +771,158 @@ GrainfreezeVoice* GrainfreezeAudioProcessor::getManualVoice() {
     return nullptr;
 }
 
-void GrainfreezeAudioProcessor::updateGlobalFftSettings() {
-    int fftSizes[] = { 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536 };
-    int idx = fftSizeParam->getIndex();
-    currentFftSize = fftSizes[idx];
-    currentAnalysisFft = analysisFftObjects[idx].get();
-    currentSynthesisFft = synthesisFftObjects[idx].get();
-    updateGlobalHopSize();
-    window.resize(static_cast<size_t>(currentFftSize)); createWindow();
-    spectrumMagnitudes.assign(static_cast<size_t>(currentFftSize / 2 + 1), 0.0f);
+const WindowBank::Windows& GrainfreezeAudioProcessor::prepareRenderResources(int fftSizeIndex, int windowType, float hopDivisor) {
+    GF_TRACE_SCOPE("prepareRenderResources");
+    int fftSize = getFftSizeForIndex(fftSizeIndex);
+    if (preparedFfts[fftSizeIndex] == nullptr)
+        preparedFfts[fftSizeIndex] = &FftBackend::getShared(getFftOrderForIndex(fftSizeIndex));
+    prepareVoiceBuffers(fftSize, trueStereoParam->get());
+    return windowBank->prepare(fftSizeIndex, windowType, hopDivisor);
+}
+
+GrainfreezeAudioProcessor::RenderBuffers GrainfreezeAudioProcessor::createRenderBuffers(int fftSize, bool stereo) const {
+    RenderBuffers buffers;
+    int currentSize = preparedFftSize.load();
+    bool currentStereo = preparedStereo.load();
+    if (fftSize <= currentSize && (!stereo || currentStereo)) return buffers;
+    buffers.fftSize = juce::jmax(currentSize, fftSize);
+    buffers.stereo = currentStereo || stereo;
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        buffers.voices.push_back(GrainfreezeVoice::createBuffers(buffers.fftSize, buffers.stereo));
+    buffers.lanes = synth.createBatchState(buffers.fftSize);
+    buffers.spectrum.reserve(static_cast<size_t>(buffers.fftSize / 2 + 1));
+    return buffers;
+}
+
+void GrainfreezeAudioProcessor::adoptRenderBuffers(RenderBuffers& buffers) noexcept {
+    // Skip buffers that an offline render has outgrown since they were created; processBlock asks again if it still needs more
+    if (buffers.fftSize == 0 || buffers.fftSize < preparedFftSize || (preparedStereo && !buffers.stereo)) return;
+    if (static_cast<int>(buffers.voices.size()) != synth.getNumVoices()) return;
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* v = dynamic_cast<GrainfreezeVoice*>(synth.getVoice(i))) v->adoptBuffers(buffers.voices[static_cast<size_t>(i)]);
+    synth.adoptBatchState(buffers.lanes);
+    buffers.spectrum.assign(spectrumMagnitudes.begin(), spectrumMagnitudes.end());   // within the reserved capacity
+    spectrumMagnitudes.swap(buffers.spectrum);
+    preparedFftSize = buffers.fftSize;
+    preparedStereo = buffers.stereo;
+}
+
+void GrainfreezeAudioProcessor::prepareVoiceBuffers(int fftSize, bool stereo) {
+    auto buffers = createRenderBuffers(fftSize, stereo);
+    adoptRenderBuffers(buffers);
+}
+
+void GrainfreezeAudioProcessor::timerCallback() {
+    if (loaderWakeRequested.exchange(false)) sampleLibrary.wakeLoader();
+    if (renderResourcesRequested.exchange(false)) prepareRequestedResources();
+
+    float position = playheadPosition.load();
+    if (playheadSyncRequested.exchange(false)) {
+        playheadParamSync = position;
+        playheadPosParam->beginChangeGesture();
+        playheadPosParam->setValueNotifyingHost(playheadPosParam->convertTo0to1(position));
+        playheadPosParam->endChangeGesture();
+    }
+    // At most playheadReadoutHz updates, and none while the position is not moving
+    if (++readoutTicks >= requestPollHz / playheadReadoutHz) {
+        readoutTicks = 0;
+        if (std::abs(position - playheadReadoutParam->get()) > 0.0005f) playheadReadoutParam->setValueNotifyingHost(playheadReadoutParam->convertTo0to1(position));
+    }
+}
+
+void GrainfreezeAudioProcessor::prepareRequestedResources() {
+    int fftSizeIndex = getFftSizeIndex();
+    int windowType = windowTypeParam->getIndex();
+    float hopDivisor = getHopDivisor();
+    // Planning the FFT, computing windows and sizing the voice buffers can all be slow,
+    // so do them before blocking the callback, which then only swaps pointers.
+    auto& fft = FftBackend::getShared(getFftOrderForIndex(fftSizeIndex));
+    windowBank->prepare(fftSizeIndex, windowType, hopDivisor);
+    auto buffers = createRenderBuffers(getFftSizeForIndex(fftSizeIndex), trueStereoParam->get());
+    const juce::ScopedLock sl(getCallbackLock());
+    adoptRenderBuffers(buffers);
+    preparedFfts[fftSizeIndex] = &fft;
+}   // the replaced buffers are freed here, after the lock is released
+
+void GrainfreezeAudioProcessor::applyRenderSettings(int fftSizeIndex, int windowType, float hopDivisor, const WindowBank::Windows& windows) {
+    GF_TRACE_SCOPE("applyRenderSettings");
+    jassert(isFftSizePrepared(fftSizeIndex) && windows.fftSize == getFftSizeForIndex(fftSizeIndex));
+    lastFftSizeIndex = fftSizeIndex; lastWindowTypeIndex = windowType; lastHopSizeValue = hopDivisor;
+    currentFftSize = windows.fftSize;
+    currentHopSize = windows.hopSize;
+    currentFft = preparedFfts[fftSizeIndex];
+    currentWindows = &windows;
+    spectrumMagnitudes.assign(static_cast<size_t>(currentFftSize / 2 + 1), 0.0f); // within the reserved capacity
 }
 
-void GrainfreezeAudioProcessor::updateGlobalHopSize() { currentHopSize = std::max(1, static_cast<int>(static_cast<float>(currentFftSize) / hopSizeParam->get())); }
-void GrainfreezeAudioProcessor::createWindow() { if (windowTypeParam->getIndex() == 0) createHannWindow(); else createBlackmanHarrisWindow(); }
-void GrainfreezeAudioProcessor::createHannWindow() { for (int i = 0; i < currentFftSize; ++i) window[static_cast<size_t>(i)] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * static_cast<float>(i) / static_cast<float>(currentFftSize - 1))); }
-void GrainfreezeAudioProcessor::createBlackmanHarrisWindow() { for (int i = 0; i < currentFftSize; ++i) { float n = static_cast<float>(i) / static_cast<float>(currentFftSize - 1); window[static_cast<size_t>(i)] = 0.35875f - 0.48829f * std::cos(2.0f * juce::MathConstants<float>::pi * n) + 0.14128f * std::cos(4.0f * juce::MathConstants<float>::pi * n) - 0.01168f * std::cos(6.0f * juce::MathConstants<float>::pi * n); } }
+int GrainfreezeAudioProcessor::getFftSizeIndex() const { int idx = fftSizeParam->getIndex(); return isQualityUpgraded() ? juce::jmin(idx + 1, numFftSizes - 1) : idx; }
+float GrainfreezeAudioProcessor::getHopDivisor() const { float h = hopSizeParam->get(); return isQualityUpgraded() ? juce::jmin(16.0f, h * 2.0f) : h; }
+
+SampleSourceView GrainfreezeAudioProcessor::getAnalysisSource(int sampleInBlock) const {
+    if (liveActive) return captureRing.getView(captureLookBack);
+    if (fadeSlot < 0 || slotFadeView.getNumSamples() == 0) return loadedView;
+    float remaining = static_cast<float>(juce::jmax(0, slotFadeRemaining - sampleInBlock));
+    return loadedView.withFadeFrom(slotFadeView, 1.0f - remaining / static_cast<float>(slotFadeLength));
+}
+
+SampleSourceView GrainfreezeAudioProcessor::getLoadedSource() const { return loadedView; }
 
 void GrainfreezeAudioProcessor::loadAudioFile(const juce::File& file) {
-    if (!file.existsAsFile()) return;
-    juce::AudioFormatManager fm; fm.registerBasicFormats();
-    std::unique_ptr<juce::AudioFormatReader> r(fm.createReaderFor(file));
-    if (r) {
-        juce::AudioBuffer<float> nb(static_cast<int>(r->numChannels), static_cast<int>(r->lengthInSamples));
-        if (r->read(&nb, 0, static_cast<int>(r->lengthInSamples), 0, true, true)) {
-            loadedAudio.makeCopyOf(nb); lastLoadedFileName = file.getFileName(); audioLoaded = true;
-            playheadPosition.store(0.0f); playbackPosition = 0.0; synth.allNotesOff(0, false);
-        }
+    GF_TRACE_SCOPE("loadAudioFile");
+    int slot = sampleSlotParam->getIndex();
+    if (!sampleLibrary.loadSlotNow(slot, file)) return;
+    apvts.state.setProperty("slot" + juce::String(slot), file.getFullPathName(), nullptr);
+    if (slot == activeSlot.load(std::memory_order_relaxed)) playbackResetPending = true;   // the callback restarts playback
+}
+
+void GrainfreezeAudioProcessor::setCurrentProgram(int index) {
+    sampleSlotParam->setValueNotifyingHost(sampleSlotParam->convertTo0to1(static_cast<float>(juce::jlimit(0, SampleLibrary::numSlots - 1, index))));
+}
+
+const juce::String GrainfreezeAudioProcessor::getProgramName(int index) {
+    auto file = sampleLibrary.getSlotFile(juce::jlimit(0, SampleLibrary::numSlots - 1, index));
+    return file == juce::File() ? "Slot " + juce::String(index + 1) : file.getFileNameWithoutExtension();
+}
+
+void GrainfreezeAudioProcessor::setSampleMemoryBudget(int megabytes) {
+    sampleCache->setMemoryBudget(static_cast<size_t>(juce::jmax(1, megabytes)) << 20);
+    sampleLibrary.wakeLoader();   // releases slots straight away if the budget shrank
+}
+
+void GrainfreezeAudioProcessor::restoreSampleSlots() {
+    sampleLibrary.setStorage(getSampleStorage());
+    apvts.state.removeProperty("sampleMemoryBudgetMB", nullptr);   // written by earlier versions; no longer applied
+    for (int i = 0; i < SampleLibrary::numSlots; ++i) {
+        auto path = apvts.state.getProperty("slot" + juce::String(i)).toString();
+        auto file = juce::File::isAbsolutePath(path) ? juce::File(path) : juce::File();
+        if (file != sampleLibrary.getSlotFile(i)) sampleLibrary.setSlotFile(i, file);
     }
 }
 
+SampleStorage GrainfreezeAudioProcessor::getSampleStorage() const {
+    return static_cast<SampleStorage>(juce::jlimit(0, static_cast<int>(SampleStorage::MonoInt16), static_cast<int>(apvts.state.getProperty("sampleStorage", 0))));
+}
+
+void GrainfreezeAudioProcessor::setSampleStorage(SampleStorage storage) {
+    if (storage == getSampleStorage()) return;
+    apvts.state.setProperty("sampleStorage", static_cast<int>(storage), nullptr);
+    sampleLibrary.setStorage(storage); // same files and lengths, so playback carries on from where it is
+}
+
 void GrainfreezeAudioProcessor::setPlayheadPosition(float np) { 
-    float cp = juce::jlimit(0.0f, 1.0f, np); double samplePos = static_cast<double>(cp) * static_cast<double>(loadedAudio.getNumSamples());
+    float cp = juce::jlimit(0.0f, 1.0f, np); double samplePos = static_cast<double>(cp) * static_cast<double>(sourceLength.load(std::memory_order_relaxed));
     if (isInFreezeMode || freezeModeParam->get()) { if (auto* v = getManualVoice()) v->smoothedFreezePosition.setTargetValue(samplePos); }
     else { playbackPosition = samplePos; playheadPosition.store(cp); if (auto* v = getManualVoice()) v->playbackPosition = samplePos; } 
 }
 
-void GrainfreezeAudioProcessor::setPlaying(bool sp) { if (sp && !playing) playbackStartPosition = playbackPosition; else if (!sp && playing) { playbackPosition = playbackStartPosition; float np = (loadedAudio.getNumSamples() > 0) ? static_cast<float>(playbackPosition / static_cast<double>(loadedAudio.getNumSamples())) : 0.0f; playheadPosition.store(np); if (playheadPosParam) { playheadPosParam->beginChangeGesture(); *playheadPosParam = np; playheadPosParam->endChangeGesture(); } lastPlayheadParam = np; } playing = sp; }
+void GrainfreezeAudioProcessor::setPlaying(bool sp) { if (sp && !playing) playbackStartPosition = playbackPosition; else if (!sp && playing) { playbackPosition = playbackStartPosition; int len = sourceLength.load(std::memory_order_relaxed); float np = (len > 0) ? static_cast<float>(playbackPosition / static_cast<double>(len)) : 0.0f; playheadPosition.store(np); playheadSyncRequested = true; } playing = sp; }
 
 juce::AudioProcessorEditor* GrainfreezeAudioProcessor::createEditor() { return new GrainfreezeAudioProcessorEditor(*this); }
 bool GrainfreezeAudioProcessor::hasEditor() const { return true; }
-void GrainfreezeAudioProcessor::getStateInformation(juce::MemoryBlock& d) { auto s = apvts.copyState(); std::unique_ptr<juce::XmlElement> x(s.createXml()); copyXmlToBinary(*x, d); }
-void GrainfreezeAudioProcessor::setStateInformation(const void* d, int s) { std::unique_ptr<juce::XmlElement> x(getXmlFromBinary(d, s)); if (x && x->hasTagName(apvts.state.getType())) apvts.replaceState(juce::ValueTree::fromXml(*x)); }
+void GrainfreezeAudioProcessor::getStateInformation(juce::MemoryBlock& d) {
+    auto s = apvts.copyState();
+    s.removeChild(s.getChildWithProperty("id", "playheadReadout"), nullptr);   // an output, not a setting
+    std::unique_ptr<juce::XmlElement> x(s.createXml()); copyXmlToBinary(*x, d);
+}
+void GrainfreezeAudioProcessor::setStateInformation(const void* d, int s) { std::unique_ptr<juce::XmlElement> x(getXmlFromBinary(d, s)); if (x && x->hasTagName(apvts.state.getType())) { apvts.replaceState(juce::ValueTree::fromXml(*x)); restoreSampleSlots(); } }
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter() { return new GrainfreezeAudioProcessor(); }
@@ -1,6 +1,14 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "FftBackend.h"
+#include "SampleCache.h"
+#include "SampleLibrary.h"
+#include "CaptureRing.h"
+#include "WindowBank.h"
+#include "Trace.h"
+#include "RealtimeCheck.h"
+#include "BatchedVoiceEngine.h"
 #include <vector>
 #include <complex>
 #include <map>
@@ -40,15 +48,50 @@ public:
     float freezeMicroMovement = 0.0f;
     int freezeMicroCounter = 0;
 
-    void allocateBuffers(int maxSize);
+    /** The per-voice vocoder buffers for one FFT size. They are built by createBuffers()
+        without touching the voice, so the allocation can happen outside the callback lock. */
+    struct Buffers
+    {
+        int fftSize = 0;
+        bool stereo = false;
+        std::vector<float> analysisFrame, fftBuffer, magnitudeBuffer, phaseAdvanceBuffer;
+        std::vector<float> previousPhase, synthesisPhase, lockPhase, outputAccum;
+        std::vector<int> lockPeaks, lockOwner;
+        std::vector<float> stereoBuffer, outputAccumR, previousPhaseR, synthesisPhaseR;
+        std::vector<float> magnitudeBufferR, phaseAdvanceBufferR, stereoPhaseDiff;
+    };
+
+    static Buffers createBuffers(int fftSize, bool withStereo);
+
+    /** Swaps b's buffers in, leaving the old ones in b for the caller to free after
+        releasing the lock. b must be at least as large as the current buffers. Drops any
+        in-flight overlap-add tail. */
+    void adoptBuffers(Buffers& b) noexcept;
+
+    void setRandomSeed(juce::int64 seed) { random.setSeed(seed); }
 
 private:
+    friend class BatchedVoiceEngine;
+
     GrainfreezeAudioProcessor& processor;
+    void prepareFft(int fftSize);
     void performPhaseVocoder();
-
-    std::unique_ptr<juce::dsp::FFT> fftAnalysis;
-    std::unique_ptr<juce::dsp::FFT> fftSynthesis;
+    void performStereoPhaseVocoder();
+    int findSpectralPeaks(int numBins);   // fills lockPeaks / lockOwner from magnitudeBuffer
+    void setStereoOutput(bool shouldBeStereo);
+    void analyseFrame();      // window + forward FFT into fftBuffer
+    void synthesiseFrame();   // inverse FFT of fftBuffer + overlap-add
+
+    // Set while BatchedVoiceEngine schedules this voice's frames instead of grainCounter
+    bool framesDrivenExternally = false;
+    bool laneNeedsReset = true;
+    int frameSample = 0;   // sample of the current block the next frame is analysed at
+
+    const FftBackend* fft = nullptr;   // shared process-wide, see FftBackend::getShared
     int currentVoiceFftSize = 0;
+    int allocatedFftSize = 0;
+    bool stereoAllocated = false;
+    bool stereoOutput = false;
 
     std::vector<float> previousPhase;
     std::vector<float> synthesisPhase;
@@ -60,6 +103,21 @@ private:
     std::vector<float> fftBuffer;
     std::vector<float> magnitudeBuffer;
     std::vector<float> phaseAdvanceBuffer;
+
+    // Phase lock: spectral peaks, the peak each bin belongs to, and each peak's synthesis phase
+    std::vector<int> lockPeaks;
+    std::vector<int> lockOwner;
+    std::vector<float> lockPhase;
+    int frameReadPos = -1, previousFrameReadPos = -1;   // last two analysed frames, -1 before the first
+
+    // True stereo: left + i * right share one complex transform; these hold the right channel
+    std::vector<float> stereoBuffer;
+    std::vector<float> outputAccumR;
+    std::vector<float> previousPhaseR;
+    std::vector<float> synthesisPhaseR;
+    std::vector<float> magnitudeBufferR;
+    std::vector<float> phaseAdvanceBufferR;
+    std::vector<float> stereoPhaseDiff;
     
     juce::LinearSmoothedValue<float> envelope;
     bool isStopping = false;
@@ -68,7 +126,36 @@ private:
 };
 
 //==============================================================================
-class GrainfreezeAudioProcessor : public juce::AudioProcessor
+/** Synthesiser that spreads active voices across worker threads when the host
+    renders offline, and renders MIDI-mode voices through the batched SIMD engine
+    in real time. */
+class GrainfreezeSynthesiser : public juce::Synthesiser
+{
+public:
+    explicit GrainfreezeSynthesiser(GrainfreezeAudioProcessor& p) : batchEngine(p) {}
+
+    void setOfflineRendering(bool shouldRenderOffline) noexcept { offline = shouldRenderOffline; }
+    bool isRenderingOffline() const noexcept { return offline; }
+    void releaseOfflineResources();
+    BatchedVoiceEngine::LaneState createBatchState(int fftSize) const { return BatchedVoiceEngine::createLaneState(fftSize, getNumVoices()); }
+    void adoptBatchState(BatchedVoiceEngine::LaneState& state) noexcept { batchEngine.adoptLaneState(state); }
+    /** Lets benchmarks compare the batched engine with the per-voice path. */
+    void setBatchingEnabled(bool shouldBatch) noexcept { batchingEnabled = shouldBatch; }
+
+protected:
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+
+private:
+    bool offline = false;
+    bool batchingEnabled = true;
+    BatchedVoiceEngine batchEngine;
+    std::unique_ptr<juce::ThreadPool> renderPool;
+    juce::OwnedArray<juce::AudioBuffer<float>> voiceBuffers;
+};
+
+//==============================================================================
+class GrainfreezeAudioProcessor : public juce::AudioProcessor,
+                                  private juce::Timer
 {
 public:
     GrainfreezeAudioProcessor();
@@ -88,19 +175,42 @@ public:
     bool isMidiEffect() const override { return false; }
     double getTailLengthSeconds() const override { return 0.0; }
 
-    int getNumPrograms() override { return 1; }
-    int getCurrentProgram() override { return 0; }
-    void setCurrentProgram(int index) override { juce::ignoreUnused(index); }
-    const juce::String getProgramName(int index) override { juce::ignoreUnused(index); return {}; }
+    // Programs are the sample slots, so hosts' program lists and MIDI program change both switch slots
+    int getNumPrograms() override { return SampleLibrary::numSlots; }
+    int getCurrentProgram() override { return activeSlot.load(std::memory_order_relaxed); }
+    void setCurrentProgram(int index) override;
+    const juce::String getProgramName(int index) override;
     void changeProgramName(int index, const juce::String& newName) override { juce::ignoreUnused(index, newName); }
 
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
+    /** Loads into the slot selected by the Sample Slot parameter, decoding on the calling thread. */
     void loadAudioFile(const juce::File& file);
-    const juce::AudioBuffer<float>& getLoadedAudio() const { return loadedAudio; }
-    bool isAudioLoaded() const { return audioLoaded; }
-    juce::String getLoadedFileName() const { return lastLoadedFileName; }
+    /** Audio thread: the active slot's audio in its stored format (empty when the slot is), as of this block. */
+    SampleSourceView getLoadedSource() const;
+    /** The active slot's audio, kept alive while the reference is held; for non-audio threads. */
+    CachedSample::Ptr getLoadedSample() const { return sampleLibrary.getSampleRef(activeSlot.load(std::memory_order_relaxed)); }
+    /** Lock-free, so safe on the audio thread; the audio itself is read through getLoadedSource(). */
+    bool isAudioLoaded() const { return sampleLibrary.isLoaded(activeSlot.load(std::memory_order_relaxed)); }
+
+    /** In-memory format for loaded files, kept in the state tree. Changing it re-encodes the loaded slots. */
+    SampleStorage getSampleStorage() const;
+    void setSampleStorage(SampleStorage storage);
+    /** Process-wide limit on decoded sample memory. Not part of any instance's state, so
+        restoring one session cannot change it for the other instances in the process. */
+    void setSampleMemoryBudget(int megabytes);
+    int getSampleMemoryBudget() const { return static_cast<int>(sampleCache->getMemoryBudget() >> 20); }
+
+    /** What the voices analyse at this sample of the current block: the live capture ring in
+        live-input mode, otherwise the loaded file (crossfaded from the previous slot after a switch). */
+    SampleSourceView getAnalysisSource(int sampleInBlock = 0) const;
+    bool isLiveInputActive() const { return liveActive; }
+    /** True-stereo rendering this block (parameter on, buffers prepared and a two-channel source). */
+    bool isTrueStereoActive() const { return trueStereoActive; }
+    /** Live mode: source position where the newest complete frame starts at this sample of the current block. */
+    double getLiveFramePosition(int sampleInBlock) const { return static_cast<double>(liveBlockStart + sampleInBlock + 1 - currentFftSize); }
+    juce::String getLoadedFileName() const { return sampleLibrary.getSlotFile(activeSlot.load(std::memory_order_relaxed)).getFileName(); }
 
     void setPlayheadPosition(float normalizedPosition);
     float getPlayheadPosition() const { return playheadPosition.load(); }
@@ -108,7 +218,15 @@ public:
     bool isPlaying() const { return playing; }
 
     const std::vector<float>& getSpectrumMagnitudes() const { return spectrumMagnitudes; }
+    /** Bumped after every rendered block / successful load so the editor can skip redundant repaints. */
+    int getSpectrumVersion() const { return spectrumVersion.load(std::memory_order_acquire); }
+    int getLoadedAudioVersion() const { return loadedAudioVersion.load(std::memory_order_acquire) + sampleLibrary.getVersion(); }
+    bool hasActiveVoices() const;
     int getCurrentFftSize() const { return currentFftSize; }
+    int getCurrentHopSize() const { return currentHopSize; }
+    int getFftSizeIndex() const;
+    float getHopDivisor() const;
+    bool isQualityUpgraded() const { return isNonRealtime() && offlineQualityParam->get(); }
     double getCurrentSampleRate() const { return currentSampleRate; }
 
     juce::AudioProcessorValueTreeState apvts;
@@ -134,22 +252,60 @@ public:
     juce::AudioParameterFloat* midiEndPosParam;
     juce::AudioParameterFloat* attackParam;
     juce::AudioParameterFloat* releaseParam;
-
-    const std::vector<float>& getWindow() const { return window; }
+    juce::AudioParameterBool* offlineQualityParam;
+    juce::AudioParameterBool* liveInputParam;
+    juce::AudioParameterBool* trueStereoParam;
+    juce::AudioParameterBool* stereoLinkParam;
+    juce::AudioParameterBool* phaseLockParam;
+    juce::AudioParameterChoice* sampleSlotParam;
+    juce::AudioParameterFloat* playheadReadoutParam;
+
+    /** Windows for the current FFT size, window type and hop. */
+    const WindowBank::Windows& getWindows() const { return *currentWindows; }
     void updateVoiceSpectrum(int bin, float magnitude);
 
-    juce::Synthesiser synth;
+    GrainfreezeSynthesiser synth;
     GrainfreezeVoice* getManualVoice();
+    /** Reseeds every voice's micro-movement RNG so renders are reproducible. */
+    void setRandomSeed(juce::int64 seed);
     std::atomic<float> midiNoteStates[128];
 
-    // Safe FFT access
-    juce::dsp::FFT* getAnalysisFft() { return currentAnalysisFft; }
-    juce::dsp::FFT* getSynthesisFft() { return currentSynthesisFft; }
+    /** FFT for the current size; shared by all voices and instances. */
+    const FftBackend* getFft() const { return currentFft; }
+    static int getFftSizeForIndex(int index) { return 512 << index; }
+    static int getFftOrderForIndex(int index) { return 9 + index; }
 
 private:
-    juce::AudioBuffer<float> loadedAudio;
-    bool audioLoaded = false;
-    juce::String lastLoadedFileName;
+    // Decoded audio is shared between instances. processBlock reads the slots lock-free
+    // inside a SampleLibrary::ReadScope and takes one view of the active slot per block.
+    juce::SharedResourcePointer<SampleCache> sampleCache;
+    SampleLibrary sampleLibrary;
+    SampleSourceView loadedView;
+    std::atomic<bool> playbackResetPending{ false };   // set by loadAudioFile, applied by processBlock
+
+    // Slot switching happens on the audio thread once the slot is decoded; the
+    // previous slot is blended out of the analysis input over slotFadeSeconds,
+    // with the gain ramped per sample (slotFadeRemaining is as of the block start).
+    static constexpr double slotFadeSeconds = 0.05;
+    std::atomic<int> activeSlot{ 0 };
+    int selectedSlot = 0;
+    int lastSlotParam = -1;
+    int fadeSlot = -1;
+    int slotFadeRemaining = 0;
+    int slotFadeLength = 1;
+    SampleSourceView slotFadeView;
+    std::atomic<int> sourceLength{ 0 };   // analysis source length as of the last block, for other threads
+    void updateSampleSlot(const juce::MidiBuffer& midiMessages, int numSamples);
+    void restoreSampleSlots();
+
+    // Live input: captured on the audio thread, paused while frozen so the held
+    // material (and up to captureSeconds of history) stays put.
+    static constexpr double captureSeconds = 10.0;
+    CaptureRing captureRing;
+    int captureLookBack = 0;
+    bool liveActive = false;
+    bool wasLiveFrozen = false;
+    int liveBlockStart = 0;
 
     std::atomic<float> playheadPosition{ 0.0f };
     bool playing = false;
@@ -158,6 +314,7 @@ private:
     float lastPlayheadParam = -1.0f;
 
     bool isInFreezeMode = false;
+    bool wasMidiMode = false;
     double freezeTargetPosition = 0.0;
     double freezeCurrentPosition = 0.0;
     juce::SmoothedValue<double> smoothedFreezePosition;
@@ -171,19 +328,57 @@ private:
     int lastWindowTypeIndex = -1;
 
     std::vector<float> spectrumMagnitudes;
-    std::vector<float> window;
+    std::atomic<int> spectrumVersion{ 0 };
+    std::atomic<int> loadedAudioVersion{ 0 };
+    juce::SharedResourcePointer<WindowBank> windowBank;
+    const WindowBank::Windows* currentWindows = nullptr;
 
     static const int numFftSizes = 8;
-    std::unique_ptr<juce::dsp::FFT> analysisFftObjects[numFftSizes];
-    std::unique_ptr<juce::dsp::FFT> synthesisFftObjects[numFftSizes];
-    juce::dsp::FFT* currentAnalysisFft = nullptr;
-    juce::dsp::FFT* currentSynthesisFft = nullptr;
-
-    void createWindow();
-    void createHannWindow();
-    void createBlackmanHarrisWindow();
-    void updateGlobalFftSettings();
-    void updateGlobalHopSize();
+    const FftBackend* currentFft = nullptr;
+
+    // Resources for an FFT size are prepared off the audio thread (or inline when
+    // rendering offline). These members only change while the callback lock is held,
+    // so processBlock reads them without touching FftBackend's cache lock. The sizes
+    // are atomic because prepareRequestedResources reads them before taking the lock.
+    const FftBackend* preparedFfts[numFftSizes] = {};
+    std::atomic<int> preparedFftSize{ 0 };   // voice buffers are sized for this
+    std::atomic<bool> preparedStereo{ false };
+    bool trueStereoActive = false;
+
+    /** Voice, lane and spectrum buffers sized off the audio thread and swapped in under the callback lock. */
+    struct RenderBuffers
+    {
+        int fftSize = 0;   // 0 when nothing needs to grow
+        bool stereo = false;
+        std::vector<GrainfreezeVoice::Buffers> voices;
+        BatchedVoiceEngine::LaneState lanes;
+        std::vector<float> spectrum;
+    };
+    RenderBuffers createRenderBuffers(int fftSize, bool stereo) const;
+    void adoptRenderBuffers(RenderBuffers& buffers) noexcept;
+    void prepareVoiceBuffers(int fftSize, bool stereo);
+    bool isFftSizePrepared(int fftSizeIndex) const { return preparedFfts[fftSizeIndex] != nullptr && getFftSizeForIndex(fftSizeIndex) <= preparedFftSize; }
+    const WindowBank::Windows& prepareRenderResources(int fftSizeIndex, int windowType, float hopDivisor);
+    void applyRenderSettings(int fftSizeIndex, int windowType, float hopDivisor, const WindowBank::Windows& windows);
+    /** Message thread: prepares the current settings' FFT, windows and buffers, then swaps them in. */
+    void prepareRequestedResources();
+
+    // The audio thread only raises flags (posting a message would lock and write to a
+    // pipe); this timer picks them up on the message thread.
+    void timerCallback() override;
+    static constexpr int requestPollHz = 30;
+    std::atomic<bool> renderResourcesRequested{ false };
+    std::atomic<bool> loaderWakeRequested{ false };
+
+    // Host-facing playhead: the read-only readout meter follows playback at
+    // playheadReadoutHz. Playhead Position stays an input; when playback moves the
+    // playhead on its own (stop, file load, live freeze) the timer writes the new
+    // position back to it, so the next user or host value is seen as a change.
+    static constexpr int playheadReadoutHz = 10;
+    int readoutTicks = 0;
+    std::atomic<bool> playheadSyncRequested{ false };
+    std::atomic<float> playheadParamSync{ -1.0f };   // value the timer wrote, which processBlock must not treat as a move
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrainfreezeAudioProcessor)
 };
@@ -0,0 +1,203 @@
+#include "RealtimeCheck.h"
+
+#if GRAINFREEZE_RT_CHECK
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <cxxabi.h>
+ #include <dlfcn.h>
+#endif
+
+#ifndef GRAINFREEZE_RT_CHECK_WRAP
+ #define GRAINFREEZE_RT_CHECK_WRAP 0
+#endif
+
+namespace
+{
+    thread_local bool inRealtimeScope = false;
+
+    // Open-addressed table keyed by return address; entries are claimed once and never removed
+    struct CallSite
+    {
+        std::atomic<void*> address{ nullptr };
+        std::atomic<const char*> function{ nullptr };
+        std::atomic<int> kind{ 0 };
+        std::atomic<juce::int64> count{ 0 };
+    };
+
+    constexpr int numCallSites = 1024;   // power of two
+    CallSite callSites[numCallSites];
+    std::atomic<juce::int64> totalViolations{ 0 };
+
+    const char* getKindName(int kind)
+    {
+        static const char* const names[] = { "allocation", "deallocation", "mutex wait", "blocking call" };
+        return names[juce::jlimit(0, static_cast<int>(RealtimeCheck::numKinds) - 1, kind)];
+    }
+
+    juce::String describeCallSite(void* address)
+    {
+        juce::String text = "0x" + juce::String::toHexString(static_cast<juce::int64>(reinterpret_cast<juce::pointer_sized_int>(address)));
+       #if JUCE_LINUX || JUCE_MAC
+        Dl_info info;
+        if (dladdr(address, &info) != 0 && info.dli_sname != nullptr) {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            text << "  " << (status == 0 && demangled != nullptr ? demangled : info.dli_sname)
+                 << " + 0x" << juce::String::toHexString(static_cast<juce::int64>(static_cast<const char*>(address) - static_cast<const char*>(info.dli_saddr)));
+            std::free(demangled);
+        }
+       #endif
+        return text;
+    }
+}
+
+void RealtimeCheck::recordViolation(Kind kind, const char* function, void* callSite) noexcept
+{
+    if (!inRealtimeScope) return;
+    totalViolations.fetch_add(1, std::memory_order_relaxed);
+
+    auto hash = static_cast<size_t>(reinterpret_cast<juce::pointer_sized_uint>(callSite) * 0x9E3779B97F4A7C15ull >> 20);
+    for (int probe = 0; probe < numCallSites; ++probe) {
+        auto& site = callSites[(hash + static_cast<size_t>(probe)) & (numCallSites - 1)];
+        void* current = site.address.load(std::memory_order_acquire);
+        if (current == nullptr && site.address.compare_exchange_strong(current, callSite, std::memory_order_acq_rel)) {
+            site.function.store(function, std::memory_order_relaxed);
+            site.kind.store(kind, std::memory_order_relaxed);
+            current = callSite;
+        }
+        if (current == callSite) { site.count.fetch_add(1, std::memory_order_relaxed); return; }
+    }
+    // Table full: the violation still counts towards the total
+}
+
+bool RealtimeCheck::isInRealtimeScope() noexcept { return inRealtimeScope; }
+juce::int64 RealtimeCheck::getNumViolations() noexcept { return totalViolations.load(std::memory_order_relaxed); }
+
+juce::String RealtimeCheck::getReport()
+{
+    juce::String report;
+    for (auto& site : callSites) {
+        auto* address = site.address.load(std::memory_order_acquire);
+        if (address == nullptr) continue;
+        auto* function = site.function.load(std::memory_order_relaxed);
+        report << juce::String(getKindName(site.kind.load(std::memory_order_relaxed))).paddedRight(' ', 14)
+               << juce::String(function != nullptr ? function : "?").paddedRight(' ', 24)
+               << juce::String(site.count.load(std::memory_order_relaxed)).paddedLeft(' ', 8) << "x  "
+               << describeCallSite(address) << "\n";
+    }
+    return report;
+}
+
+RealtimeScope::RealtimeScope(bool active) noexcept : wasInScope(inRealtimeScope) { inRealtimeScope = wasInScope || active; }
+RealtimeScope::~RealtimeScope() { inRealtimeScope = wasInScope; }
+
+//==============================================================================
+// Interceptors. The recorded call site is the caller of the intercepted function.
+#define GF_RT_RECORD(kind, name) RealtimeCheck::recordViolation(RealtimeCheck::kind, name, __builtin_return_address(0))
+
+#if GRAINFREEZE_RT_CHECK_WRAP
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <pthread.h>
+ #include <semaphore.h>
+ #include <sys/select.h>
+ #include <time.h>
+ #include <unistd.h>
+
+extern "C"
+{
+    void* __real_malloc(size_t);
+    void* __real_calloc(size_t, size_t);
+    void* __real_realloc(void*, size_t);
+    void __real_free(void*);
+    int __real_posix_memalign(void**, size_t, size_t);
+    void* __real_aligned_alloc(size_t, size_t);
+    int __real_pthread_mutex_lock(pthread_mutex_t*);
+    int __real_pthread_cond_wait(pthread_cond_t*, pthread_mutex_t*);
+    int __real_pthread_cond_timedwait(pthread_cond_t*, pthread_mutex_t*, const struct timespec*);
+    int __real_pthread_join(pthread_t, void**);
+    int __real_sem_wait(sem_t*);
+    ssize_t __real_read(int, void*, size_t);
+    ssize_t __real_write(int, const void*, size_t);
+    int __real_open(const char*, int, ...);
+    int __real_close(int);
+    int __real_fsync(int);
+    int __real_poll(struct pollfd*, nfds_t, int);
+    int __real_select(int, fd_set*, fd_set*, fd_set*, struct timeval*);
+    int __real_nanosleep(const struct timespec*, struct timespec*);
+    int __real_clock_nanosleep(clockid_t, int, const struct timespec*, struct timespec*);
+    int __real_usleep(useconds_t);
+    unsigned int __real_sleep(unsigned int);
+
+    void* __wrap_malloc(size_t n) { GF_RT_RECORD(allocation, "malloc"); return __real_malloc(n); }
+    void* __wrap_calloc(size_t n, size_t s) { GF_RT_RECORD(allocation, "calloc"); return __real_calloc(n, s); }
+    void* __wrap_realloc(void* p, size_t n) { GF_RT_RECORD(allocation, "realloc"); return __real_realloc(p, n); }
+    void __wrap_free(void* p) { if (p != nullptr) GF_RT_RECORD(deallocation, "free"); __real_free(p); }
+    int __wrap_posix_memalign(void** p, size_t a, size_t n) { GF_RT_RECORD(allocation, "posix_memalign"); return __real_posix_memalign(p, a, n); }
+    void* __wrap_aligned_alloc(size_t a, size_t n) { GF_RT_RECORD(allocation, "aligned_alloc"); return __real_aligned_alloc(a, n); }
+
+    // An uncontended lock never blocks, so only locks that would have to wait are violations
+    int __wrap_pthread_mutex_lock(pthread_mutex_t* m)
+    {
+        if (pthread_mutex_trylock(m) == 0) return 0;
+        GF_RT_RECORD(mutexWait, "pthread_mutex_lock");
+        return __real_pthread_mutex_lock(m);
+    }
+
+    int __wrap_pthread_cond_wait(pthread_cond_t* c, pthread_mutex_t* m) { GF_RT_RECORD(blockingCall, "pthread_cond_wait"); return __real_pthread_cond_wait(c, m); }
+    int __wrap_pthread_cond_timedwait(pthread_cond_t* c, pthread_mutex_t* m, const struct timespec* t) { GF_RT_RECORD(blockingCall, "pthread_cond_timedwait"); return __real_pthread_cond_timedwait(c, m, t); }
+    int __wrap_pthread_join(pthread_t t, void** r) { GF_RT_RECORD(blockingCall, "pthread_join"); return __real_pthread_join(t, r); }
+    int __wrap_sem_wait(sem_t* s) { GF_RT_RECORD(blockingCall, "sem_wait"); return __real_sem_wait(s); }
+    ssize_t __wrap_read(int fd, void* b, size_t n) { GF_RT_RECORD(blockingCall, "read"); return __real_read(fd, b, n); }
+    ssize_t __wrap_write(int fd, const void* b, size_t n) { GF_RT_RECORD(blockingCall, "write"); return __real_write(fd, b, n); }
+    int __wrap_close(int fd) { GF_RT_RECORD(blockingCall, "close"); return __real_close(fd); }
+    int __wrap_fsync(int fd) { GF_RT_RECORD(blockingCall, "fsync"); return __real_fsync(fd); }
+    int __wrap_poll(struct pollfd* f, nfds_t n, int t) { GF_RT_RECORD(blockingCall, "poll"); return __real_poll(f, n, t); }
+    int __wrap_select(int n, fd_set* r, fd_set* w, fd_set* e, struct timeval* t) { GF_RT_RECORD(blockingCall, "select"); return __real_select(n, r, w, e, t); }
+    int __wrap_nanosleep(const struct timespec* t, struct timespec* r) { GF_RT_RECORD(blockingCall, "nanosleep"); return __real_nanosleep(t, r); }
+    int __wrap_clock_nanosleep(clockid_t c, int f, const struct timespec* t, struct timespec* r) { GF_RT_RECORD(blockingCall, "clock_nanosleep"); return __real_clock_nanosleep(c, f, t, r); }
+    int __wrap_usleep(useconds_t u) { GF_RT_RECORD(blockingCall, "usleep"); return __real_usleep(u); }
+    unsigned int __wrap_sleep(unsigned int s) { GF_RT_RECORD(blockingCall, "sleep"); return __real_sleep(s); }
+
+    int __wrap_open(const char* path, int flags, ...)
+    {
+        GF_RT_RECORD(blockingCall, "open");
+        mode_t mode = 0;
+        if ((flags & O_CREAT) != 0) { va_list args; va_start(args, flags); mode = static_cast<mode_t>(va_arg(args, int)); va_end(args); }
+        return __real_open(path, flags, mode);
+    }
+}
+
+ #define GF_RT_MALLOC __real_malloc
+ #define GF_RT_FREE __real_free
+#else
+ #define GF_RT_MALLOC std::malloc
+ #define GF_RT_FREE std::free
+#endif
+
+// Global operator new/delete: the portable half of the checker, and the only way to
+// see allocations made inside the C++ runtime, which linker wrapping cannot reach.
+namespace
+{
+    void* allocateOrThrow(std::size_t size)
+    {
+        if (void* p = GF_RT_MALLOC(size == 0 ? 1 : size)) return p;
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(std::size_t n) { GF_RT_RECORD(allocation, "operator new"); return allocateOrThrow(n); }
+void* operator new[](std::size_t n) { GF_RT_RECORD(allocation, "operator new[]"); return allocateOrThrow(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { GF_RT_RECORD(allocation, "operator new"); return GF_RT_MALLOC(n == 0 ? 1 : n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { GF_RT_RECORD(allocation, "operator new[]"); return GF_RT_MALLOC(n == 0 ? 1 : n); }
+void operator delete(void* p) noexcept { if (p != nullptr) GF_RT_RECORD(deallocation, "operator delete"); GF_RT_FREE(p); }
+void operator delete[](void* p) noexcept { if (p != nullptr) GF_RT_RECORD(deallocation, "operator delete[]"); GF_RT_FREE(p); }
+void operator delete(void* p, std::size_t) noexcept { if (p != nullptr) GF_RT_RECORD(deallocation, "operator delete"); GF_RT_FREE(p); }
+void operator delete[](void* p, std::size_t) noexcept { if (p != nullptr) GF_RT_RECORD(deallocation, "operator delete[]"); GF_RT_FREE(p); }
+
+#endif
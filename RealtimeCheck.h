@@ -0,0 +1,51 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef GRAINFREEZE_RT_CHECK
+ #define GRAINFREEZE_RT_CHECK 0
+#endif
+
+#if GRAINFREEZE_RT_CHECK
+
+//==============================================================================
+/** Real-time safety checker (enabled with the GRAINFREEZE_RT_CHECK CMake option).
+
+    While a RealtimeScope is active on a thread, these calls on that thread are
+    recorded as violations, keyed by call site:
+    - heap allocation and release, through replaced global operator new/delete;
+    - on Linux, also the C allocator, mutex locks that had to wait, and blocking
+      or sleeping system calls, through linker wrapping (--wrap).
+    Recording is lock-free and allocation-free. It is a debugging aid only.
+*/
+class RealtimeCheck
+{
+public:
+    enum Kind { allocation, deallocation, mutexWait, blockingCall, numKinds };
+
+    /** Called by the interceptors; does nothing outside a RealtimeScope. */
+    static void recordViolation(Kind kind, const char* function, void* callSite) noexcept;
+    static bool isInRealtimeScope() noexcept;
+
+    static juce::int64 getNumViolations() noexcept;
+    /** One line per call site: function, count, return address and symbol where it can be resolved. */
+    static juce::String getReport();
+};
+
+/** Marks the enclosing scope as real-time on this thread (when active is true). */
+class RealtimeScope
+{
+public:
+    explicit RealtimeScope(bool active) noexcept;
+    ~RealtimeScope();
+
+private:
+    bool wasInScope;
+
+    JUCE_DECLARE_NON_COPYABLE(RealtimeScope)
+};
+
+ #define GF_REALTIME_SCOPE(active) const RealtimeScope JUCE_JOIN_MACRO(gfRealtimeScope_, __LINE__)(active)
+#else
+ #define GF_REALTIME_SCOPE(active)
+#endif
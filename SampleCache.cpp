@@ -0,0 +1,134 @@
+#include "SampleCache.h"
+
+//==============================================================================
+// CachedSample
+//==============================================================================
+
+CachedSample::CachedSample(Key sampleKey, juce::AudioBuffer<float>&& decodedAudio)
+    : key(std::move(sampleKey)), peaks(computePeaks(decodedAudio)), numSamples(decodedAudio.getNumSamples())
+{
+    switch (key.storage) {
+        case SampleStorage::Float32:
+            floatAudio = std::move(decodedAudio);
+            break;
+        case SampleStorage::MonoFloat32:
+            floatAudio.setSize(1, numSamples);
+            floatAudio.copyFrom(0, 0, decodedAudio, 0, 0, numSamples);
+            if (decodedAudio.getNumChannels() > 1) {
+                floatAudio.addFrom(0, 0, decodedAudio, 1, 0, numSamples);
+                floatAudio.applyGain(0.5f);
+            }
+            break;
+        case SampleStorage::Int16:
+        case SampleStorage::Int24:
+        case SampleStorage::MonoInt16: {
+            bool mono = key.storage == SampleStorage::MonoInt16;
+            if (mono && decodedAudio.getNumChannels() > 1) {
+                decodedAudio.addFrom(0, 0, decodedAudio, 1, 0, numSamples);
+                decodedAudio.applyGain(0, 0, numSamples, 0.5f);
+            }
+            // Only the first two channels are ever read, so the rest are dropped
+            bool is16 = key.storage != SampleStorage::Int24;
+            numChannels = juce::jmin(mono ? 1 : 2, decodedAudio.getNumChannels());
+            size_t planeBytes = static_cast<size_t>(numSamples) * (is16 ? 2u : 3u);
+            packedBytes = planeBytes * static_cast<size_t>(numChannels);
+            packed.malloc(juce::jmax(packedBytes, static_cast<size_t>(1)));
+            for (int ch = 0; ch < numChannels; ++ch) {
+                const float* src = decodedAudio.getReadPointer(ch);
+                char* plane = packed.get() + planeBytes * static_cast<size_t>(ch);
+                if (is16) {
+                    auto* dest = reinterpret_cast<juce::int16*>(plane);
+                    for (int i = 0; i < numSamples; ++i) dest[i] = static_cast<juce::int16>(juce::roundToInt(juce::jlimit(-1.0f, 1.0f, src[i]) * 32767.0f));
+                } else {
+                    auto* dest = reinterpret_cast<juce::uint8*>(plane);
+                    for (int i = 0; i < numSamples; ++i) {
+                        int v = juce::roundToInt(juce::jlimit(-1.0f, 1.0f, src[i]) * 8388607.0f);
+                        dest[3 * i] = static_cast<juce::uint8>(v); dest[3 * i + 1] = static_cast<juce::uint8>(v >> 8); dest[3 * i + 2] = static_cast<juce::uint8>(v >> 16);
+                    }
+                }
+            }
+            break;
+        }
+    }
+    if (packedBytes == 0) numChannels = floatAudio.getNumChannels();
+}
+
+std::vector<juce::Range<float>> CachedSample::computePeaks(const juce::AudioBuffer<float>& a)
+{
+    std::vector<juce::Range<float>> result;
+    if (a.getNumChannels() == 0) return result;
+    int numSamples = a.getNumSamples();
+    result.reserve(static_cast<size_t>((numSamples + peakBlockSize - 1) / peakBlockSize));
+    for (int start = 0; start < numSamples; start += peakBlockSize)
+        result.push_back(juce::FloatVectorOperations::findMinAndMax(a.getReadPointer(0, start), juce::jmin(peakBlockSize, numSamples - start)));
+    return result;
+}
+
+SampleSourceView CachedSample::getView() const noexcept
+{
+    if (packedBytes == 0) return SampleSourceView::fromBuffer(floatAudio);
+
+    size_t planeBytes = packedBytes / static_cast<size_t>(numChannels);
+    const void* planes[2] = { packed.get(), packed.get() + (numChannels > 1 ? planeBytes : 0) };
+    return SampleSourceView::fromPlanes(planes, numChannels, numSamples, key.storage == SampleStorage::Int24 ? SampleSourceView::Encoding::Int24 : SampleSourceView::Encoding::Int16);
+}
+
+size_t CachedSample::getMemoryUsage() const
+{
+    return static_cast<size_t>(floatAudio.getNumChannels()) * static_cast<size_t>(floatAudio.getNumSamples()) * sizeof(float)
+         + packedBytes + peaks.size() * sizeof(juce::Range<float>);
+}
+
+//==============================================================================
+// SampleCache
+//==============================================================================
+
+SampleCache::SampleCache() { formatManager.registerBasicFormats(); }
+
+CachedSample::Ptr SampleCache::getOrLoad(const juce::File& file, SampleStorage storage)
+{
+    if (!file.existsAsFile()) return nullptr;
+
+    // Opening the reader only parses the header; decoding happens on a miss.
+    std::unique_ptr<juce::AudioFormatReader> r(formatManager.createReaderFor(file));
+    if (r == nullptr) return nullptr;
+
+    CachedSample::Key key{ file.getFullPathName(), file.getLastModificationTime().toMilliseconds(), r->sampleRate, storage };
+    if (auto existing = find(key)) return existing;
+
+    // Decode and convert without the lock, so memory queries and other loads are never held up by the disk
+    juce::AudioBuffer<float> nb(static_cast<int>(r->numChannels), static_cast<int>(r->lengthInSamples));
+    if (!r->read(&nb, 0, static_cast<int>(r->lengthInSamples), 0, true, true)) return nullptr;
+    CachedSample::Ptr entry = new CachedSample(std::move(key), std::move(nb));
+
+    purgeUnused();
+    const juce::ScopedLock sl(lock);
+    for (auto* e : entries)
+        if (e->key == entry->key) return e;   // decoded concurrently elsewhere; share that one, ours is freed after the lock
+    entries.add(entry);
+    return entry;
+}
+
+CachedSample::Ptr SampleCache::find(const CachedSample::Key& key) const
+{
+    const juce::ScopedLock sl(lock);
+    for (auto* e : entries)
+        if (e->key == key) return e;
+    return nullptr;
+}
+
+void SampleCache::purgeUnused()
+{
+    const juce::ScopedLock sl(lock);
+    for (int i = entries.size(); --i >= 0;)
+        if (entries.getObjectPointerUnchecked(i)->getReferenceCount() == 1)
+            entries.remove(i);
+}
+
+size_t SampleCache::getMemoryUsage() const
+{
+    const juce::ScopedLock sl(lock);
+    size_t total = 0;
+    for (auto* e : entries) total += e->getMemoryUsage();
+    return total;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureRing.h"
+#include <atomic>
+#include <vector>
+
+/** How a cached sample holds its audio in memory. Against Float32, Int24 holds
+    3/4 of the bytes, Int16 and MonoFloat32 (for stereo files) half, and MonoInt16
+    a quarter. Append new formats, since the index is saved in plugin state. */
+enum class SampleStorage { Float32, Int16, Int24, MonoFloat32, MonoInt16 };
+
+//==============================================================================
+/** Decoded audio file shared read-only between plugin instances.
+    Everything is filled in at construction and never modified afterwards. */
+class CachedSample : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<CachedSample>;
+
+    struct Key
+    {
+        juce::String path;
+        juce::int64 modificationTime = 0;
+        double sampleRate = 0.0;
+        SampleStorage storage = SampleStorage::Float32;
+
+        bool operator==(const Key& other) const { return path == other.path && modificationTime == other.modificationTime && sampleRate == other.sampleRate && storage == other.storage; }
+    };
+
+    /** Converts decodedAudio into key.storage; the peaks are taken before any quantisation. */
+    CachedSample(Key sampleKey, juce::AudioBuffer<float>&& decodedAudio);
+
+    const Key key;
+
+    /** Per-block min/max of channel 0, for drawing overviews without touching the samples. */
+    static const int peakBlockSize = 256;
+    const std::vector<juce::Range<float>> peaks;
+
+    int getNumSamples() const noexcept { return numSamples; }
+    int getNumChannels() const noexcept { return numChannels; }
+
+    /** Reads through the stored format; valid for as long as this object is. */
+    SampleSourceView getView() const noexcept;
+
+    size_t getMemoryUsage() const;
+
+private:
+    static std::vector<juce::Range<float>> computePeaks(const juce::AudioBuffer<float>& audio);
+
+    int numChannels = 0;
+    int numSamples = 0;
+    juce::AudioBuffer<float> floatAudio;   // Float32 and MonoFloat32
+    juce::HeapBlock<char> packed;          // Int16 / Int24 / MonoInt16: one plane per channel, back to back
+    size_t packedBytes = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(CachedSample)
+};
+
+//==============================================================================
+/** Process-wide cache of decoded samples, keyed by path, modification time and
+    sample rate. Hold it through juce::SharedResourcePointer<SampleCache>; entries
+    live for as long as some instance references them.
+
+    getOrLoad() decodes from disk outside the cache lock, so the other calls only
+    ever wait for a list lookup. Never use it from the audio thread.
+*/
+class SampleCache
+{
+public:
+    SampleCache();
+
+    /** Returns the shared decoded file in the given storage, decoding it only if no live entry matches. */
+    CachedSample::Ptr getOrLoad(const juce::File& file, SampleStorage storage = SampleStorage::Float32);
+
+    /** Drops entries that no instance references any more. */
+    void purgeUnused();
+
+    size_t getMemoryUsage() const;
+
+    /** Soft limit on decoded audio across all instances; each SampleLibrary releases its
+        least recently used slots while the cache is above it. */
+    void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+    size_t getMemoryBudget() const { return memoryBudget; }
+    static constexpr size_t defaultMemoryBudget = static_cast<size_t>(1) << 30;
+
+private:
+    CachedSample::Ptr find(const CachedSample::Key& key) const;
+
+    std::atomic<size_t> memoryBudget{ defaultMemoryBudget };
+    juce::CriticalSection lock;
+    juce::ReferenceCountedArray<CachedSample> entries;
+    juce::AudioFormatManager formatManager;   // registered once in the constructor, then only read
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleCache)
+};
@@ -0,0 +1,172 @@
+#include "SampleLibrary.h"
+#include "Trace.h"
+
+SampleLibrary::SampleLibrary(SampleCache& c)
+    : juce::Thread("Grainfreeze sample loader"), cache(c)
+{
+}
+
+SampleLibrary::~SampleLibrary()
+{
+    stopThread(5000);
+    for (auto& s : slots) { s.live = nullptr; s.sample = nullptr; }
+    cache.purgeUnused();
+}
+
+void SampleLibrary::setSlotFile(int slot, const juce::File& file)
+{
+    install(slot, file, nullptr);
+    wakeLoader();
+}
+
+bool SampleLibrary::loadSlotNow(int slot, const juce::File& file)
+{
+    CachedSample::Ptr sample = cache.getOrLoad(file, getStorage());
+    if (sample == nullptr) return false;
+    install(slot, file, std::move(sample));
+    enforceBudget();
+    return true;
+}
+
+juce::File SampleLibrary::getSlotFile(int slot) const
+{
+    const juce::ScopedLock sl(slotLock);
+    return slots[static_cast<size_t>(slot)].file;
+}
+
+void SampleLibrary::setStorage(SampleStorage newStorage)
+{
+    {
+        const juce::ScopedLock sl(slotLock);
+        if (storage == newStorage) return;
+        storage = newStorage;
+        for (auto& s : slots) s.released = s.failed = false;
+    }
+    wakeLoader();
+}
+
+CachedSample::Ptr SampleLibrary::getSampleRef(int slot) const
+{
+    const juce::ScopedLock sl(slotLock);
+    return slots[static_cast<size_t>(slot)].sample;
+}
+
+void SampleLibrary::setBusySlots(int active, int fading, int pending) noexcept
+{
+    busyActive = active; busyFading = fading; busyPending = pending;
+    auto now = ++useClock;
+    for (int s : { active, fading, pending })
+        if (s >= 0) slots[static_cast<size_t>(s)].lastUsed.store(now, std::memory_order_relaxed);
+}
+
+bool SampleLibrary::requestLoad(int slot) noexcept
+{
+    return !slots[static_cast<size_t>(slot)].requested.exchange(true);
+}
+
+void SampleLibrary::wakeLoader()
+{
+    if (!isThreadRunning()) startThread(juce::Thread::Priority::background);
+    notify();
+}
+
+//==============================================================================
+void SampleLibrary::install(int slot, const juce::File& file, CachedSample::Ptr sample)
+{
+    auto& s = slots[static_cast<size_t>(slot)];
+    {
+        const juce::ScopedLock sl(slotLock);
+        if (file != s.file) { s.file = file; s.failed = false; }
+        s.released = false;
+        s.requested = false;
+        s.lastUsed.store(++useClock, std::memory_order_relaxed);
+        std::swap(s.sample, sample);
+        s.live.store(s.sample.get());
+    }
+    version.fetch_add(1, std::memory_order_release);
+    if (sample != nullptr) waitForReaders(slot);
+    sample = nullptr; // release the previous audio outside the lock, once no callback can be reading it
+    cache.purgeUnused();
+}
+
+int SampleLibrary::findSlotToLoad() const
+{
+    // Ask the cache first: never wait on its lock while holding slotLock
+    bool overBudget = cache.getMemoryUsage() >= cache.getMemoryBudget();
+    const juce::ScopedLock sl(slotLock);
+    int candidate = -1;
+    for (int i = 0; i < numSlots; ++i) {
+        const auto& s = slots[static_cast<size_t>(i)];
+        if (s.file == juce::File() || s.failed) continue;
+        bool stale = s.sample == nullptr || s.sample->key.storage != storage;
+        if (!stale) continue;
+        if (s.requested.load()) return i;                                   // selected slots come first
+        if (candidate < 0 && !s.released && !(overBudget && s.sample == nullptr)) candidate = i;   // then background preloads
+    }
+    return candidate;
+}
+
+void SampleLibrary::run()
+{
+    GF_TRACE_THREAD("Sample loader");
+    while (!threadShouldExit()) {
+        int slot = findSlotToLoad();
+        if (slot < 0) { enforceBudget(); wait(-1); continue; }
+
+        auto& s = slots[static_cast<size_t>(slot)];
+        juce::File file;
+        SampleStorage wanted = SampleStorage::Float32;
+        { const juce::ScopedLock sl(slotLock); file = s.file; wanted = storage; s.released = false; }
+
+        GF_TRACE_SCOPE("SampleLibrary::load");
+        CachedSample::Ptr sample = cache.getOrLoad(file, wanted);
+        {
+            const juce::ScopedLock sl(slotLock);
+            if (s.file != file) continue;   // reassigned while decoding
+            if (sample == nullptr) { s.failed = true; continue; }
+        }
+        install(slot, file, std::move(sample));
+        enforceBudget();
+    }
+}
+
+void SampleLibrary::enforceBudget()
+{
+    while (cache.getMemoryUsage() > cache.getMemoryBudget()) {
+        CachedSample::Ptr released;
+        int evicted = -1;
+        {
+            const juce::ScopedLock sl(slotLock);
+            int victim = -1;
+            for (int i = 0; i < numSlots; ++i) {
+                const auto& s = slots[static_cast<size_t>(i)];
+                // Only slots this library holds alone (plus the cache's entry) free anything when dropped
+                if (s.sample == nullptr || isBusy(i) || s.sample->getReferenceCount() > 2) continue;
+                if (victim < 0 || s.lastUsed.load() < slots[static_cast<size_t>(victim)].lastUsed.load()) victim = i;
+            }
+            if (victim < 0) return;
+            evicted = victim;
+            std::swap(released, slots[static_cast<size_t>(victim)].sample);
+            slots[static_cast<size_t>(victim)].live.store(nullptr);
+            slots[static_cast<size_t>(victim)].released = true;
+            slots[static_cast<size_t>(victim)].requested = false;
+        }
+        version.fetch_add(1, std::memory_order_release);
+        waitForReaders(evicted);   // the callback may have marked it since it was picked
+        released = nullptr;
+        cache.purgeUnused();
+    }
+}
+
+void SampleLibrary::waitForReaders(int slot) const
+{
+    // The callback marks the slots it reads before reading them, and the new pointer was
+    // stored before these loads (all sequentially consistent). So a slot that is not marked
+    // now cannot be read by a running callback with the old pointer, and later callbacks
+    // see the new one: background preloads and evictions of idle slots never wait. For a
+    // marked slot, only a callback already inside its scope can hold the old pointer.
+    if (!isBusy(slot)) return;
+    auto epoch = readerEpoch.load();
+    if ((epoch & 1) == 0) return;
+    while (readerEpoch.load() == epoch) juce::Thread::sleep(1);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleCache.h"
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/** Per-instance bank of sample slots, decoded on a background thread through the
+    shared SampleCache so that switching slots never waits for the disk.
+
+    The audio callback reads slots lock-free: each slot publishes a raw pointer
+    to its audio, and a replaced sample is only released once no callback that
+    might have picked up the old pointer is still running (see ReadScope). Other
+    threads read slots through getSampleRef(). Whenever the cache is over its
+    memory budget, the loader releases this library's least recently used slots,
+    never the ones the callback has marked busy (playing, fading out or waiting
+    to be switched to). Released slots keep their file and are decoded again
+    when selected.
+*/
+class SampleLibrary : private juce::Thread
+{
+public:
+    static constexpr int numSlots = 8;
+
+    explicit SampleLibrary(SampleCache& cache);
+    ~SampleLibrary() override;
+
+    /** Assigns a file and decodes it in the background; an empty file clears the slot. */
+    void setSlotFile(int slot, const juce::File& file);
+    /** Decodes on the calling thread and installs the result; false if the file cannot be read. */
+    bool loadSlotNow(int slot, const juce::File& file);
+    juce::File getSlotFile(int slot) const;
+
+    /** Re-encodes every loaded slot in the background; each keeps playing its old data until replaced. */
+    void setStorage(SampleStorage newStorage);
+    SampleStorage getStorage() const { return storage; }
+
+    /** Keeps the slot's audio alive for as long as the reference is held; for non-audio threads. */
+    CachedSample::Ptr getSampleRef(int slot) const;
+    /** Any thread, lock-free: whether the slot currently holds decoded audio. */
+    bool isLoaded(int slot) const noexcept { return slots[static_cast<size_t>(slot)].live.load() != nullptr; }
+
+    /** Brackets an audio callback that reads slot samples: audio replaced while a callback
+        is inside one is released only after that callback has left it. Never nest them. */
+    class ReadScope
+    {
+    public:
+        explicit ReadScope(SampleLibrary& l) noexcept : library(l) { library.readerEpoch.fetch_add(1); }
+        ~ReadScope() { library.readerEpoch.fetch_add(1); }
+
+    private:
+        SampleLibrary& library;
+        JUCE_DECLARE_NON_COPYABLE(ReadScope)
+    };
+
+    /** Audio thread, inside a ReadScope: nullptr while the slot is empty, loading or released.
+        Valid until the scope ends. */
+    CachedSample* getSample(int slot) const noexcept { return slots[static_cast<size_t>(slot)].live.load(); }
+    /** Audio thread, inside a ReadScope and before any getSample() call: marks the slots the
+        callback may read (or -1) and bumps their LRU stamp. Marked slots are never evicted,
+        and only replacing a marked slot has to wait for the callback to finish. */
+    void setBusySlots(int active, int fading, int pending) noexcept;
+    /** Audio thread: asks for a released or unloaded slot; returns true the first time so the caller can wake the loader. */
+    bool requestLoad(int slot) noexcept;
+    /** Message thread: starts the loader on first use and lets it pick up new requests. */
+    void wakeLoader();
+
+    /** Bumped whenever any slot's contents change. */
+    int getVersion() const noexcept { return version.load(std::memory_order_acquire); }
+
+private:
+    struct Slot
+    {
+        juce::File file;
+        CachedSample::Ptr sample;
+        std::atomic<CachedSample*> live{ nullptr };   // sample.get(), published for the audio callback
+        bool released = false;   // dropped to stay within the budget
+        bool failed = false;
+        std::atomic<bool> requested{ false };
+        std::atomic<juce::uint64> lastUsed{ 0 };
+    };
+
+    void run() override;
+    int findSlotToLoad() const;
+    void install(int slot, const juce::File& file, CachedSample::Ptr sample);
+    void enforceBudget();
+    bool isBusy(int slot) const noexcept { return slot == busyActive || slot == busyFading || slot == busyPending; }
+    /** After replacing slot's pointer: blocks until no callback can still hold the old one. */
+    void waitForReaders(int slot) const;
+
+    SampleCache& cache;
+    juce::CriticalSection slotLock;   // files, flags, storage and the owning sample pointers
+    std::array<Slot, numSlots> slots;
+    SampleStorage storage = SampleStorage::Float32;
+    std::atomic<int> busyActive{ -1 }, busyFading{ -1 }, busyPending{ -1 };
+    std::atomic<juce::uint32> readerEpoch{ 0 };   // odd while a callback is inside a ReadScope
+    std::atomic<juce::uint64> useClock{ 0 };
+    std::atomic<int> version{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleLibrary)
+};
@@ -0,0 +1,176 @@
+#include "Trace.h"
+
+#if GRAINFREEZE_TRACING
+#include <array>
+#include <atomic>
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char* name = nullptr;
+        juce::int64 startTicks = 0;
+        juce::int64 endTicks = 0;
+    };
+
+    /** Single-writer ring owned by one thread at a time; readers take best-effort snapshots.
+        A released ring keeps its events and carries on with its next owner. */
+    struct ThreadRing
+    {
+        static constexpr size_t capacity = 1 << 16;
+
+        std::array<TraceEvent, capacity> events;
+        std::atomic<juce::uint64> writeIndex{ 0 };
+        std::atomic<juce::Thread::ThreadID> owner{ nullptr };   // null while free
+        std::atomic<const char*> label{ nullptr };   // set by nameCurrentThread()
+        std::atomic<bool> isMessageThread{ false };
+        int threadIndex = 0;
+
+        // Copied into a juce::String only here, when the trace is written
+        juce::String getDisplayName() const
+        {
+            if (auto* name = label.load()) return name;
+            return isMessageThread.load() ? juce::String("Message thread") : "Thread " + juce::String(threadIndex);
+        }
+    };
+
+    constexpr int maxThreads = 64;
+    std::array<std::atomic<ThreadRing*>, maxThreads> rings{};
+    std::atomic<int> numRings{ 0 };
+    std::atomic<juce::uint64> droppedEvents{ 0 };
+
+    // Rings are never freed, so snapshots can read them at any time.
+    ThreadRing* createRing()
+    {
+        if (numRings.load() >= maxThreads) return nullptr;   // keeps failed claims from counting on forever
+        int index = numRings.fetch_add(1);
+        if (index >= maxThreads) return nullptr;
+        auto* ring = new ThreadRing();
+        ring->threadIndex = index;
+        rings[static_cast<size_t>(index)].store(ring, std::memory_order_release);
+        return ring;
+    }
+
+    // Looked up by thread ID rather than cached in a thread_local, whose first use can
+    // allocate (dynamic TLS in a plugin binary) and which is never told the thread exited.
+    ThreadRing* findRing(juce::Thread::ThreadID id)
+    {
+        int count = juce::jmin(numRings.load(), maxThreads);
+        for (int i = 0; i < count; ++i)
+            if (auto* ring = rings[static_cast<size_t>(i)].load(std::memory_order_acquire); ring != nullptr && ring->owner.load() == id) return ring;
+        return nullptr;
+    }
+
+    ThreadRing* claimRing(juce::Thread::ThreadID id)
+    {
+        ThreadRing* ring = nullptr;
+        int count = juce::jmin(numRings.load(), maxThreads);
+        for (int i = 0; i < count && ring == nullptr; ++i) {
+            auto* candidate = rings[static_cast<size_t>(i)].load(std::memory_order_acquire);
+            juce::Thread::ThreadID expected = nullptr;
+            if (candidate != nullptr && candidate->owner.compare_exchange_strong(expected, id)) ring = candidate;
+        }
+        if (ring == nullptr && (ring = createRing()) == nullptr) return nullptr;
+        ring->owner = id;
+        ring->label = nullptr;
+        ring->isMessageThread = juce::MessageManager::existsAndIsCurrentThread();
+        return ring;
+    }
+
+    ThreadRing* getRingForCurrentThread()
+    {
+        auto id = juce::Thread::getCurrentThreadId();
+        if (auto* ring = findRing(id)) return ring;
+        return claimRing(id);
+    }
+
+    double ticksToMicroseconds(juce::int64 ticks)
+    {
+        return static_cast<double>(ticks) * 1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    }
+}
+
+void TraceRecorder::record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept
+{
+    auto* ring = getRingForCurrentThread();
+    if (ring == nullptr) { droppedEvents.fetch_add(1, std::memory_order_relaxed); return; }
+
+    auto w = ring->writeIndex.load(std::memory_order_relaxed);
+    ring->events[static_cast<size_t>(w % ThreadRing::capacity)] = { name, startTicks, endTicks };
+    ring->writeIndex.store(w + 1, std::memory_order_release);
+}
+
+void TraceRecorder::reserveRings(int numSpare)
+{
+    static juce::CriticalSection reserveLock;
+    const juce::ScopedLock sl(reserveLock);
+    int count = juce::jmin(numRings.load(), maxThreads), spare = 0;
+    for (int i = 0; i < count; ++i)
+        if (auto* ring = rings[static_cast<size_t>(i)].load(std::memory_order_acquire)) spare += ring->owner.load() != nullptr ? 0 : 1;
+    for (; spare < numSpare; ++spare)
+        if (createRing() == nullptr) break;
+}
+
+void TraceRecorder::nameCurrentThread(const char* threadName) noexcept
+{
+    if (auto* ring = getRingForCurrentThread()) ring->label = threadName;
+}
+
+void TraceRecorder::releaseCurrentThread() noexcept
+{
+    if (auto* ring = findRing(juce::Thread::getCurrentThreadId())) ring->owner = nullptr;
+}
+
+juce::uint64 TraceRecorder::getNumDroppedEvents() noexcept
+{
+    return droppedEvents.load(std::memory_order_relaxed);
+}
+
+juce::String TraceRecorder::toChromeTraceJson()
+{
+    juce::MemoryOutputStream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&out, &first] { if (!first) out << ","; first = false; };
+
+    int count = juce::jmin(numRings.load(), maxThreads);
+    for (int i = 0; i < count; ++i) {
+        auto* ring = rings[static_cast<size_t>(i)].load(std::memory_order_acquire);
+        if (ring == nullptr || ring->writeIndex.load(std::memory_order_acquire) == 0) continue;
+
+        separator();
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->threadIndex
+            << ",\"args\":{\"name\":" << juce::JSON::toString(ring->getDisplayName()) << "}}";
+
+        // Copy the live window, then drop anything the writer may have overwritten meanwhile.
+        auto end = ring->writeIndex.load(std::memory_order_acquire);
+        auto begin = end > ThreadRing::capacity ? end - ThreadRing::capacity : 0;
+        std::vector<TraceEvent> snapshot;
+        snapshot.reserve(static_cast<size_t>(end - begin));
+        for (auto idx = begin; idx < end; ++idx) snapshot.push_back(ring->events[static_cast<size_t>(idx % ThreadRing::capacity)]);
+        auto after = ring->writeIndex.load(std::memory_order_acquire);
+        size_t firstValid = after > begin + ThreadRing::capacity ? static_cast<size_t>(after - ThreadRing::capacity - begin) : 0;
+
+        for (size_t e = firstValid; e < snapshot.size(); ++e) {
+            const auto& ev = snapshot[e];
+            if (ev.name == nullptr) continue;
+            separator();
+            out << "{\"ph\":\"X\",\"cat\":\"grainfreeze\",\"name\":\"" << ev.name << "\",\"pid\":1,\"tid\":" << ring->threadIndex
+                << ",\"ts\":" << juce::String(ticksToMicroseconds(ev.startTicks), 3)
+                << ",\"dur\":" << juce::String(ticksToMicroseconds(ev.endTicks - ev.startTicks), 3) << "}";
+        }
+    }
+    if (auto dropped = droppedEvents.load(std::memory_order_relaxed); dropped > 0) {
+        separator();
+        out << "{\"ph\":\"i\",\"s\":\"g\",\"cat\":\"grainfreeze\",\"name\":\"trace thread limit (" << maxThreads << ") reached, "
+            << juce::String(static_cast<juce::int64>(dropped)) << " events dropped\",\"pid\":1,\"tid\":0,\"ts\":0}";
+    }
+    out << "]}";
+    return out.toString();
+}
+
+bool TraceRecorder::writeChromeTrace(const juce::File& file)
+{
+    return file.replaceWithText(toChromeTraceJson());
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef GRAINFREEZE_TRACING
+ #define GRAINFREEZE_TRACING 0
+#endif
+
+#if GRAINFREEZE_TRACING
+
+//==============================================================================
+/** Hot-path trace capture (enabled with the GRAINFREEZE_ENABLE_TRACING CMake option).
+
+    Each thread records completed scopes into its own fixed-size ring; recording is
+    lock-free and allocation-free. A thread's first record claims one of the rings
+    created by reserveRings(), and only allocates a ring if none is left. Once full,
+    a ring overwrites its oldest events. At most 64 rings exist; threads that find
+    none free are counted as dropped and reported in the exported trace.
+*/
+class TraceRecorder
+{
+public:
+    /** @param name must be a string literal (only the pointer is stored). */
+    static void record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+
+    /** Creates rings until at least numSpare are unclaimed; call off the audio thread. */
+    static void reserveRings(int numSpare);
+
+    /** Labels the calling thread's ring (claiming one if needed) or hands it back for reuse.
+        @param threadName must be a string literal (only the pointer is stored). */
+    static void nameCurrentThread(const char* threadName) noexcept;
+    static void releaseCurrentThread() noexcept;
+
+    /** Events lost because every ring was claimed by another thread. */
+    static juce::uint64 getNumDroppedEvents() noexcept;
+
+    /** Snapshot of all rings as Chrome trace-event JSON (chrome://tracing, Perfetto). */
+    static juce::String toChromeTraceJson();
+    static bool writeChromeTrace(const juce::File& file);
+};
+
+/** Records the enclosing scope as one complete ("X") trace event. */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* scopeName) noexcept : name(scopeName), start(juce::Time::getHighResolutionTicks()) {}
+    ~TraceScope() { TraceRecorder::record(name, start, juce::Time::getHighResolutionTicks()); }
+
+private:
+    const char* name;
+    juce::int64 start;
+
+    JUCE_DECLARE_NON_COPYABLE(TraceScope)
+};
+
+/** Names the calling thread's ring for its lifetime, then releases the ring, so
+    short-lived threads (render workers, sample loaders) don't use up the rings. */
+class TraceThreadScope
+{
+public:
+    explicit TraceThreadScope(const char* threadName) noexcept { TraceRecorder::nameCurrentThread(threadName); }
+    ~TraceThreadScope() { TraceRecorder::releaseCurrentThread(); }
+
+    JUCE_DECLARE_NON_COPYABLE(TraceThreadScope)
+};
+
+ #define GF_TRACE_SCOPE(name) const TraceScope JUCE_JOIN_MACRO(gfTraceScope_, __LINE__)(name)
+ #define GF_TRACE_THREAD(name) const TraceThreadScope JUCE_JOIN_MACRO(gfTraceThread_, __LINE__)(name)
+#else
+ #define GF_TRACE_SCOPE(name)
+ #define GF_TRACE_THREAD(name)
+#endif
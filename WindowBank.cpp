@@ -0,0 +1,55 @@
+#include "WindowBank.h"
+#include "Trace.h"
+
+size_t WindowBank::getEntryIndex(int sizeIndex, int type, float hopDivisor) noexcept
+{
+    jassert(sizeIndex >= 0 && sizeIndex < numSizes && type >= 0 && type < numTypes);
+    return static_cast<size_t>((sizeIndex * numTypes + type) * numHopDivisors + getDivisor(hopDivisor) - minHopDivisor);
+}
+
+int WindowBank::getHopSize(int fftSize, float hopDivisor) noexcept
+{
+    return std::max(1, fftSize / getDivisor(hopDivisor));
+}
+
+const WindowBank::Windows* WindowBank::find(int sizeIndex, int type, float hopDivisor) const noexcept
+{
+    return published[getEntryIndex(sizeIndex, type, hopDivisor)].load(std::memory_order_acquire);
+}
+
+const WindowBank::Windows& WindowBank::prepare(int sizeIndex, int type, float hopDivisor)
+{
+    auto index = getEntryIndex(sizeIndex, type, hopDivisor);
+    if (auto* w = published[index].load(std::memory_order_acquire)) return *w;
+
+    GF_TRACE_SCOPE("WindowBank::prepare");
+    const juce::ScopedLock sl(lock);
+    if (auto* w = published[index].load(std::memory_order_acquire)) return *w;
+
+    int fftSize = 512 << sizeIndex;
+    auto& analysis = analysisWindows[static_cast<size_t>(sizeIndex * numTypes + type)];
+    if (analysis.empty()) fillWindow(analysis, fftSize, type);
+
+    auto entry = std::make_unique<Entry>();
+    int hopSize = getHopSize(fftSize, hopDivisor);
+    float norm = 2.0f / (static_cast<float>(fftSize) / static_cast<float>(hopSize));
+    entry->synthesis.resize(analysis.size());
+    juce::FloatVectorOperations::multiply(entry->synthesis.data(), analysis.data(), norm, fftSize);
+    entry->windows = { fftSize, hopSize, analysis.data(), entry->synthesis.data() };
+
+    auto* w = &entry->windows;
+    entries[index] = std::move(entry);
+    published[index].store(w, std::memory_order_release);
+    return *w;
+}
+
+void WindowBank::fillWindow(std::vector<float>& window, int fftSize, int type)
+{
+    window.resize(static_cast<size_t>(fftSize));
+    for (int i = 0; i < fftSize; ++i) {
+        float n = static_cast<float>(i) / static_cast<float>(fftSize - 1);
+        window[static_cast<size_t>(i)] = type == 0
+            ? 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * n))
+            : 0.35875f - 0.48829f * std::cos(2.0f * juce::MathConstants<float>::pi * n) + 0.14128f * std::cos(4.0f * juce::MathConstants<float>::pi * n) - 0.01168f * std::cos(6.0f * juce::MathConstants<float>::pi * n);
+    }
+}
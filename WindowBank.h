@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+/** Process-wide set of analysis / synthesis windows for every FFT size, window
+    type and hop divisor. Hold it through juce::SharedResourcePointer<WindowBank>.
+
+    The synthesis window has the overlap-add normalisation (2 * hop / fftSize)
+    folded in. Entries are built on first request and are immutable once published,
+    so the audio thread can look them up without locks or allocation.
+*/
+class WindowBank
+{
+public:
+    static constexpr int numSizes = 8;   // 512 ... 65536
+    static constexpr int numTypes = 2;   // Hann, Blackman-Harris
+    static constexpr int minHopDivisor = 2;
+    static constexpr int maxHopDivisor = 16;
+
+    struct Windows
+    {
+        int fftSize = 0;
+        int hopSize = 0;
+        const float* analysis = nullptr;
+        const float* synthesis = nullptr;
+    };
+
+    WindowBank() = default;
+
+    /** Lock-free; returns nullptr if these windows have not been prepared yet. */
+    const Windows* find(int sizeIndex, int type, float hopDivisor) const noexcept;
+
+    /** Builds the windows if needed. Takes a lock and may allocate, so keep it off the audio thread. */
+    const Windows& prepare(int sizeIndex, int type, float hopDivisor);
+
+    /** Hops follow the voices' integer division: max(1, fftSize / int(hopDivisor)). */
+    static int getHopSize(int fftSize, float hopDivisor) noexcept;
+
+private:
+    static constexpr int numHopDivisors = maxHopDivisor - minHopDivisor + 1;
+
+    struct Entry
+    {
+        Windows windows;
+        std::vector<float> synthesis;
+    };
+
+    juce::CriticalSection lock;
+    std::array<std::vector<float>, numSizes * numTypes> analysisWindows;   // written under lock, before publishing
+    std::array<std::unique_ptr<Entry>, numSizes * numTypes * numHopDivisors> entries;
+    std::array<std::atomic<const Windows*>, numSizes * numTypes * numHopDivisors> published{};
+
+    static int getDivisor(float hopDivisor) noexcept { return juce::jlimit(minHopDivisor, maxHopDivisor, static_cast<int>(hopDivisor)); }
+    static size_t getEntryIndex(int sizeIndex, int type, float hopDivisor) noexcept;
+    static void fillWindow(std::vector<float>& window, int fftSize, int type);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WindowBank)
+};
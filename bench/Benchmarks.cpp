@@ -0,0 +1,776 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    /** Resident set size of this process in bytes, or -1 where it cannot be read. */
+    juce::int64 getResidentBytes()
+    {
+       #if JUCE_LINUX
+        auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), " ", {});
+        if (fields.size() > 1) return fields[1].getLargeIntValue() * static_cast<juce::int64>(sysconf(_SC_PAGESIZE));
+       #endif
+        return -1;
+    }
+
+    juce::String describeBytes(juce::int64 bytes)
+    {
+        return bytes < 0 ? juce::String("n/a") : juce::File::descriptionOfSizeInBytes(bytes);
+    }
+
+    int getIntOption(const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+    {
+        return args.containsOption(option) ? args.getValueForOption(option).getIntValue() : defaultValue;
+    }
+
+    double getDoubleOption(const juce::ArgumentList& args, const juce::String& option, double defaultValue)
+    {
+        return args.containsOption(option) ? args.getValueForOption(option).getDoubleValue() : defaultValue;
+    }
+
+    void setParameter(GrainfreezeAudioProcessor& p, const juce::String& id, float value)
+    {
+        auto* param = p.apvts.getParameter(id);
+        param->setValueNotifyingHost(param->convertTo0to1(value));
+    }
+
+    //==============================================================================
+    /** Cost of a host scan / session load: constructing instances, then preparing them. */
+    void runInstantiation(const juce::ArgumentList& args)
+    {
+        const int count = juce::jmax(1, getIntOption(args, "--instances", 32));
+        std::vector<std::unique_ptr<GrainfreezeAudioProcessor>> instances;
+        instances.reserve(static_cast<size_t>(count));
+
+        auto rssStart = getResidentBytes();
+        auto start = juce::Time::getMillisecondCounterHiRes();
+        for (int i = 0; i < count; ++i) instances.push_back(std::make_unique<GrainfreezeAudioProcessor>());
+        auto constructed = juce::Time::getMillisecondCounterHiRes();
+        auto rssConstructed = getResidentBytes();
+
+        // The first prepare also plans (and benchmarks) the shared FFT, so time it separately.
+        instances.front()->prepareToPlay(48000.0, 512);
+        auto firstPrepared = juce::Time::getMillisecondCounterHiRes();
+        for (size_t i = 1; i < instances.size(); ++i) instances[i]->prepareToPlay(48000.0, 512);
+        auto prepared = juce::Time::getMillisecondCounterHiRes();
+        auto rssPrepared = getResidentBytes();
+
+        auto perInstance = [count](juce::int64 bytes) { return bytes < 0 ? bytes : bytes / count; };
+        std::cout << "instances:          " << count << "\n"
+                  << "construct:          " << juce::String((constructed - start) / count, 3) << " ms/instance, "
+                  << describeBytes(perInstance(rssConstructed < 0 ? -1 : rssConstructed - rssStart)) << "/instance\n"
+                  << "prepare (first):    " << juce::String(firstPrepared - constructed, 3) << " ms\n"
+                  << "prepare (others):   " << juce::String(count > 1 ? (prepared - firstPrepared) / (count - 1) : 0.0, 3) << " ms/instance\n"
+                  << "prepared total:     " << describeBytes(perInstance(rssPrepared < 0 ? -1 : rssPrepared - rssStart)) << "/instance\n";
+    }
+
+    //==============================================================================
+    // Golden renders: deterministic scenarios checked against small summaries committed in
+    // bench/golden/references.txt (run by ctest), or with --dir against full renders recorded
+    // earlier (e.g. before an optimisation), so DSP changes can be checked by ear-free numbers.
+    constexpr double goldenSampleRate = 48000.0;
+    constexpr int goldenBlockSize = 512;
+    constexpr juce::int64 goldenSeed = 0x5eed;
+
+    struct GoldenScenario
+    {
+        juce::String source, mode;
+        int fftSizeIndex = 3, windowType = 1;   // the parameter defaults
+        float hopDivisor = 4.0f;
+        bool phaseLock = false, trueStereo = false, stereoLink = true, offline = false;
+        bool batching = true;   // not part of the name: equivalence checks only
+        int noteSpacing = 0;    // samples between successive MIDI note starts; equivalence checks only
+        SampleStorage storage = SampleStorage::Float32;
+
+        juce::String getName() const
+        {
+            static const char* const storageNames[] = { "", "-int16", "-int24", "-monofloat", "-monoint16" };
+            return source + "-" + mode + "-fft" + juce::String(GrainfreezeAudioProcessor::getFftSizeForIndex(fftSizeIndex)) + (windowType == 0 ? "-hann" : "-bh")
+                 + (hopDivisor != 4.0f ? "-hop" + juce::String(juce::roundToInt(hopDivisor)) : juce::String())
+                 + (phaseLock ? "-lock" : "") + (trueStereo ? (stereoLink ? "-truestereo" : "-truestereo-unlinked") : "")
+                 + storageNames[static_cast<int>(storage)] + (offline ? "-offline" : "");
+        }
+    };
+
+    /** Every FFT size and window for the three basic modes, then the other render paths
+        (overlaps, phase lock, True Stereo, compact storage, offline rendering) at the default size. */
+    std::vector<GoldenScenario> getGoldenScenarios()
+    {
+        std::vector<GoldenScenario> list;
+        auto make = [](const char* source, const char* mode) { GoldenScenario s; s.source = source; s.mode = mode; return s; };
+        for (auto source : { "sine", "noise", "chirp" })
+            for (auto mode : { "play", "freeze", "midi" })
+                for (int sizeIndex = 0; sizeIndex < 8; ++sizeIndex)
+                    for (int windowType = 0; windowType < 2; ++windowType) {
+                        auto s = make(source, mode);
+                        s.fftSizeIndex = sizeIndex; s.windowType = windowType;
+                        list.push_back(s);
+                    }
+
+        for (auto mode : { "play", "freeze" })
+            for (float hop : { 2.0f, 8.0f, 16.0f }) { auto s = make("chord", mode); s.hopDivisor = hop; list.push_back(s); }
+        for (auto mode : { "play", "freeze", "midi" }) { auto s = make("chord", mode); s.phaseLock = true; list.push_back(s); }
+        for (auto mode : { "play", "freeze" }) {
+            list.push_back(make("stereo", mode));   // mono downmix path
+            for (bool link : { true, false }) { auto s = make("stereo", mode); s.trueStereo = true; s.stereoLink = link; list.push_back(s); }
+        }
+        { auto s = make("stereo", "play"); s.trueStereo = s.phaseLock = true; list.push_back(s); }
+        for (auto storage : { SampleStorage::Int16, SampleStorage::Int24, SampleStorage::MonoFloat32, SampleStorage::MonoInt16 }) {
+            auto s = make("stereo", "play"); s.storage = storage; list.push_back(s);
+            if (storage == SampleStorage::Int16 || storage == SampleStorage::Int24) { s.trueStereo = true; list.push_back(s); }
+        }
+        for (auto mode : { "play", "midi" }) { auto s = make("chord", mode); s.offline = true; list.push_back(s); }
+        return list;
+    }
+
+    /** Three seconds of a sine, seeded white noise, a log chirp (100 Hz - 8 kHz), a steady chord
+        of three harmonic tones, or (for "stereo") the chord left and the chirp right, written as a float WAV. */
+    juce::File writeGoldenSource(const juce::File& dir, const juce::String& kind)
+    {
+        const int numSamples = static_cast<int>(3.0 * goldenSampleRate);
+        const int numChannels = kind == "stereo" ? 2 : 1;
+        juce::AudioBuffer<float> b(numChannels, numSamples);
+        juce::Random random(goldenSeed);
+        double phase = 0.0;
+        for (int i = 0; i < numSamples; ++i) {
+            double t = static_cast<double>(i) / goldenSampleRate;
+            double freq = kind == "chirp" || kind == "stereo" ? 100.0 * std::pow(80.0, t / 3.0) : 440.0;
+            phase += juce::MathConstants<double>::twoPi * freq / goldenSampleRate;
+            float value = kind == "noise" ? (random.nextFloat() * 2.0f - 1.0f) * 0.25f : 0.5f * static_cast<float>(std::sin(phase));
+            if (kind == "chord" || kind == "stereo") {
+                float chord = 0.0f;
+                for (double root : { 220.0, 277.18, 329.63 })
+                    for (int h = 1; h <= 8; ++h)
+                        chord += 0.12f / static_cast<float>(h) * static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * root * h * t + h));
+                if (kind == "stereo") b.setSample(1, i, value);   // the chirp
+                value = chord;
+            }
+            b.setSample(0, i, value);
+        }
+
+        auto file = dir.getChildFile(kind + ".wav");
+        file.deleteFile();
+        if (auto out = file.createOutputStream()) {
+            std::unique_ptr<juce::AudioFormatWriter> writer(juce::WavAudioFormat().createWriterFor(out.get(), goldenSampleRate, static_cast<unsigned int>(numChannels), 32, {}, 0));
+            if (writer != nullptr) { out.release(); writer->writeFromAudioSampleBuffer(b, 0, numSamples); }
+        }
+        return file;
+    }
+
+    /** Prepares p (settings are prepared here, so no message loop is needed) and renders numSamples
+        in blocks, starting playback in "play" mode and feeding events (timed in samples from the start)
+        and, if given, input as the processor's audio input. */
+    juce::AudioBuffer<float> renderBlocks(GrainfreezeAudioProcessor& p, const juce::String& mode, int numSamples,
+                                          const juce::MidiBuffer& events = {}, const juce::AudioBuffer<float>* input = nullptr)
+    {
+        p.prepareToPlay(goldenSampleRate, goldenBlockSize);
+        if (mode == "play") p.setPlaying(true);
+
+        juce::AudioBuffer<float> out(2, numSamples), block(2, goldenBlockSize);
+        juce::MidiBuffer midi;
+        for (int pos = 0; pos < numSamples; pos += goldenBlockSize) {
+            int n = juce::jmin(goldenBlockSize, numSamples - pos);
+            block.setSize(2, n, false, false, true);
+            block.clear();
+            if (input != nullptr)
+                for (int ch = 0; ch < juce::jmin(2, input->getNumChannels()); ++ch) block.copyFrom(ch, 0, *input, ch, pos, n);
+            midi.clear();
+            midi.addEvents(events, pos, n, -pos);
+            p.processBlock(block, midi);
+            for (int ch = 0; ch < 2; ++ch) out.copyFrom(ch, pos, block, ch, 0, n);
+        }
+        p.releaseResources();
+        return out;
+    }
+
+    juce::AudioBuffer<float> renderGoldenScenario(const GoldenScenario& s, const juce::File& sourceFile, int numSamples)
+    {
+        GrainfreezeAudioProcessor p;
+        setParameter(p, "fftSize", static_cast<float>(s.fftSizeIndex));
+        setParameter(p, "windowType", static_cast<float>(s.windowType));
+        setParameter(p, "hopSize", s.hopDivisor);
+        setParameter(p, "freezeMode", s.mode == "freeze" ? 1.0f : 0.0f);
+        setParameter(p, "midiMode", s.mode == "midi" ? 1.0f : 0.0f);
+        setParameter(p, "phaseLock", s.phaseLock ? 1.0f : 0.0f);
+        setParameter(p, "trueStereo", s.trueStereo ? 1.0f : 0.0f);
+        setParameter(p, "stereoLink", s.stereoLink ? 1.0f : 0.0f);
+        setParameter(p, "microMovement", 25.0f);
+        p.setSampleStorage(s.storage);
+        p.setNonRealtime(s.offline);
+        p.synth.setBatchingEnabled(s.batching);
+        p.setRandomSeed(goldenSeed);
+        p.loadAudioFile(sourceFile);
+        juce::MidiBuffer notes;
+        if (s.mode == "midi")
+            for (int i = 0; i < 3; ++i) notes.addEvent(juce::MidiMessage::noteOn(1, 48 + 12 * i, 0.8f), i * s.noteSpacing);
+        return renderBlocks(p, s.mode, numSamples, notes);
+    }
+
+    /** Writes each golden source once per run into the temp directory. */
+    class GoldenSources
+    {
+    public:
+        GoldenSources() { dir.createDirectory(); }
+        juce::File get(const juce::String& kind)
+        {
+            auto& file = files[kind];
+            if (file == juce::File()) file = writeGoldenSource(dir, kind);
+            return file;
+        }
+
+    private:
+        juce::File dir = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("grainfreeze-golden-sources");
+        std::map<juce::String, juce::File> files;
+    };
+
+    /** SNR of out against ref over all channels, in dB (infinite when both are silent). */
+    double getSnrDb(const juce::AudioBuffer<float>& out, const juce::AudioBuffer<float>& ref)
+    {
+        double signal = 0.0, noise = 0.0;
+        for (int ch = 0; ch < ref.getNumChannels(); ++ch)
+            for (int i = 0; i < ref.getNumSamples(); ++i) {
+                double r = ref.getSample(ch, i), d = out.getSample(ch, i) - r;
+                signal += r * r; noise += d * d;
+            }
+        if (noise < 1.0e-20) return std::numeric_limits<double>::infinity();
+        return 10.0 * std::log10(juce::jmax(signal, 1.0e-20) / noise);
+    }
+
+    /** Mean log-spectral distance (dB) between the channel sums, over 2048-point Hann frames. */
+    double getSpectralDistanceDb(const juce::AudioBuffer<float>& out, const juce::AudioBuffer<float>& ref)
+    {
+        constexpr int order = 11, size = 1 << order, hop = size / 2;
+        juce::dsp::FFT fft(order);
+        std::vector<float> window(size), a(2 * size), b(2 * size);
+        for (int i = 0; i < size; ++i) window[static_cast<size_t>(i)] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * static_cast<float>(i) / size);
+
+        double total = 0.0;
+        int frames = 0;
+        for (int start = 0; start + size <= ref.getNumSamples(); start += hop) {
+            std::fill(a.begin(), a.end(), 0.0f); std::fill(b.begin(), b.end(), 0.0f);
+            for (int ch = 0; ch < ref.getNumChannels(); ++ch)
+                for (int i = 0; i < size; ++i) {
+                    a[static_cast<size_t>(i)] += out.getSample(ch, start + i) * window[static_cast<size_t>(i)];
+                    b[static_cast<size_t>(i)] += ref.getSample(ch, start + i) * window[static_cast<size_t>(i)];
+                }
+            fft.performRealOnlyForwardTransform(a.data(), true);
+            fft.performRealOnlyForwardTransform(b.data(), true);
+
+            double sum = 0.0, energy = 0.0;
+            for (int k = 0; k <= size / 2; ++k) {
+                double pa = a[2 * k] * a[2 * k] + a[2 * k + 1] * a[2 * k + 1];
+                double pb = b[2 * k] * b[2 * k] + b[2 * k + 1] * b[2 * k + 1];
+                double d = 10.0 * std::log10((pa + 1.0e-9) / (pb + 1.0e-9));
+                sum += d * d; energy += pa + pb;
+            }
+            if (energy < 1.0e-9) continue;   // silent in both
+            total += std::sqrt(sum / (size / 2 + 1));
+            ++frames;
+        }
+        return frames > 0 ? total / frames : 0.0;
+    }
+
+    //==============================================================================
+    /** Level and coarse spectrum of each output channel: what the committed references hold. */
+    struct GoldenSummary
+    {
+        static constexpr int numBands = 16;   // log-spaced, 40 Hz - 20 kHz
+        float levelDb[2] = {};
+        float bandDb[2][numBands] = {};
+    };
+
+    struct GoldenTolerance
+    {
+        double levelDb = 0.5;   // RMS level per channel
+        double bandDb = 1.5;    // band level, for bands within rangeDb of the loudest reference band
+        double rangeDb = 60.0;
+    };
+
+    struct GoldenReferences
+    {
+        double seconds = 2.0;
+        GoldenTolerance tolerance;
+        std::map<juce::String, GoldenSummary> entries;
+    };
+
+    GoldenSummary summarise(const juce::AudioBuffer<float>& out)
+    {
+        constexpr int order = 11, size = 1 << order, hop = size / 2;
+        juce::dsp::FFT fft(order);
+        std::vector<float> window(size), frame(2 * size);
+        for (int i = 0; i < size; ++i) window[static_cast<size_t>(i)] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * static_cast<float>(i) / size);
+
+        GoldenSummary summary;
+        for (int ch = 0; ch < 2; ++ch) {
+            summary.levelDb[ch] = juce::Decibels::gainToDecibels(out.getRMSLevel(ch, 0, out.getNumSamples()), -120.0f);
+
+            std::vector<double> power(size / 2 + 1, 0.0);
+            int frames = 0;
+            for (int start = 0; start + size <= out.getNumSamples(); start += hop, ++frames) {
+                std::fill(frame.begin(), frame.end(), 0.0f);
+                for (int i = 0; i < size; ++i) frame[static_cast<size_t>(i)] = out.getSample(ch, start + i) * window[static_cast<size_t>(i)];
+                fft.performRealOnlyForwardTransform(frame.data(), true);
+                for (int k = 0; k <= size / 2; ++k) power[static_cast<size_t>(k)] += frame[2 * k] * frame[2 * k] + frame[2 * k + 1] * frame[2 * k + 1];
+            }
+
+            // Scaled so a full-scale sine reads about 0 dB in its band
+            const double scale = 16.0 / (static_cast<double>(size) * size * juce::jmax(1, frames));
+            for (int b = 0; b < GoldenSummary::numBands; ++b) {
+                double lo = 40.0 * std::pow(500.0, static_cast<double>(b) / GoldenSummary::numBands);
+                double hi = 40.0 * std::pow(500.0, static_cast<double>(b + 1) / GoldenSummary::numBands);
+                int k0 = juce::jlimit(1, size / 2, static_cast<int>(std::ceil(lo * size / goldenSampleRate)));
+                int k1 = juce::jlimit(k0 + 1, size / 2 + 1, static_cast<int>(std::ceil(hi * size / goldenSampleRate)));
+                double sum = 0.0;
+                for (int k = k0; k < k1; ++k) sum += power[static_cast<size_t>(k)];
+                summary.bandDb[ch][b] = static_cast<float>(10.0 * std::log10(sum * scale + 1.0e-12));
+            }
+        }
+        return summary;
+    }
+
+    /** Largest level and band deviations of out from ref, in dB. */
+    std::pair<double, double> compareSummaries(const GoldenSummary& out, const GoldenSummary& ref, double rangeDb)
+    {
+        double levelError = 0.0, bandError = 0.0;
+        for (int ch = 0; ch < 2; ++ch) {
+            levelError = juce::jmax(levelError, static_cast<double>(std::abs(out.levelDb[ch] - ref.levelDb[ch])));
+            float loudest = *std::max_element(std::begin(ref.bandDb[ch]), std::end(ref.bandDb[ch]));
+            for (int b = 0; b < GoldenSummary::numBands; ++b)
+                if (juce::jmax(out.bandDb[ch][b], ref.bandDb[ch][b]) >= loudest - rangeDb)
+                    bandError = juce::jmax(bandError, static_cast<double>(std::abs(out.bandDb[ch][b] - ref.bandDb[ch][b])));
+        }
+        return { levelError, bandError };
+    }
+
+    /** Text format: '#' comments, one "settings" line of key/value pairs, then one line per
+        scenario: its name, the two channel levels and the two channels' bands, all in dB. */
+    GoldenReferences loadGoldenReferences(const juce::File& file)
+    {
+        GoldenReferences refs;
+        for (auto& line : juce::StringArray::fromLines(file.loadFileAsString())) {
+            auto tokens = juce::StringArray::fromTokens(line, " ", {});
+            tokens.removeEmptyStrings();
+            if (tokens.isEmpty() || tokens[0].startsWith("#")) continue;
+            if (tokens[0] == "settings") {
+                for (int i = 1; i + 1 < tokens.size(); i += 2) {
+                    double value = tokens[i + 1].getDoubleValue();
+                    if (tokens[i] == "seconds") refs.seconds = value;
+                    else if (tokens[i] == "level-tol") refs.tolerance.levelDb = value;
+                    else if (tokens[i] == "band-tol") refs.tolerance.bandDb = value;
+                    else if (tokens[i] == "range") refs.tolerance.rangeDb = value;
+                }
+                continue;
+            }
+            if (tokens.size() != 3 + 2 * GoldenSummary::numBands) continue;
+            GoldenSummary s;
+            int t = 1;
+            for (auto& level : s.levelDb) level = tokens[t++].getFloatValue();
+            for (auto& channel : s.bandDb)
+                for (auto& band : channel) band = tokens[t++].getFloatValue();
+            refs.entries[tokens[0]] = s;
+        }
+        return refs;
+    }
+
+    bool saveGoldenReferences(const juce::File& file, const GoldenReferences& refs, const std::vector<GoldenScenario>& order)
+    {
+        juce::String text;
+        text << "# Golden render summaries, checked by 'GrainfreezeBench golden' (ctest: golden).\n"
+             << "# Re-record with 'GrainfreezeBench golden --record' only for intended output changes.\n"
+             << "# <scenario> <level L> <level R> <" << GoldenSummary::numBands << " bands L> <" << GoldenSummary::numBands << " bands R>, in dB\n"
+             << "settings seconds " << refs.seconds << " level-tol " << refs.tolerance.levelDb
+             << " band-tol " << refs.tolerance.bandDb << " range " << refs.tolerance.rangeDb << "\n";
+        for (const auto& scenario : order) {
+            auto it = refs.entries.find(scenario.getName());
+            if (it == refs.entries.end()) continue;
+            text << it->first;
+            for (auto level : it->second.levelDb) text << " " << juce::String(level, 2);
+            for (auto& channel : it->second.bandDb)
+                for (auto band : channel) text << " " << juce::String(band, 2);
+            text << "\n";
+        }
+        file.getParentDirectory().createDirectory();
+        return file.replaceWithText(text);
+    }
+
+    /** Uses one FFT backend for every size (default: the bundled radix FFT, which is the same
+        code on every platform), so results do not depend on the startup benchmark's timing. */
+    void pinFftBackend(const juce::ArgumentList& args)
+    {
+        auto name = args.containsOption("--fft") ? args.getValueForOption("--fft") : juce::String("radix");
+        if (name == "fastest") return;
+        for (auto kind : { FftBackend::Kind::Juce, FftBackend::Kind::Radix, FftBackend::Kind::Fftw })
+            if (name.equalsIgnoreCase(FftBackend::getKindName(kind))) {
+                if (!FftBackend::isAvailable(kind)) juce::ConsoleApplication::fail(name + " FFT is not compiled in");
+                FftBackend::forceKind(kind);
+                return;
+            }
+        juce::ConsoleApplication::fail("unknown --fft backend '" + name + "' (juce, radix, fftw or fastest)");
+    }
+
+    void runGolden(const juce::ArgumentList& args)
+    {
+        pinFftBackend(args);
+        const bool record = args.containsOption("--record");
+        const auto filter = args.getValueForOption("--filter");
+        const bool fullRenders = args.containsOption("--dir");
+        auto cwd = juce::File::getCurrentWorkingDirectory();
+        auto refFile = cwd.getChildFile(args.containsOption("--references") ? args.getValueForOption("--references") : "bench/golden/references.txt");
+        auto dir = fullRenders ? cwd.getChildFile(args.getValueForOption("--dir")) : juce::File();
+
+        auto refs = fullRenders ? GoldenReferences() : loadGoldenReferences(refFile);
+        if (!fullRenders && !record && refs.entries.empty())
+            juce::ConsoleApplication::fail("no references in " + refFile.getFullPathName() + " - record them with 'golden --record --fft=radix' and commit the file");
+        refs.seconds = getDoubleOption(args, "--seconds", refs.seconds);
+        refs.tolerance.levelDb = getDoubleOption(args, "--level-tol", refs.tolerance.levelDb);
+        refs.tolerance.bandDb = getDoubleOption(args, "--band-tol", refs.tolerance.bandDb);
+        const double minSnr = getDoubleOption(args, "--min-snr", 40.0);
+        const double maxDistance = getDoubleOption(args, "--max-lsd", 1.0);
+        const int numSamples = static_cast<int>(refs.seconds * goldenSampleRate);
+        if (fullRenders) dir.createDirectory();
+
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        GoldenSources sources;
+        auto scenarios = getGoldenScenarios();
+
+        int failures = 0, count = 0;
+        double totalMs = 0.0;
+        for (const auto& s : scenarios) {
+            auto name = s.getName();
+            if (filter.isNotEmpty() && !name.contains(filter)) continue;
+
+            auto start = juce::Time::getMillisecondCounterHiRes();
+            auto out = renderGoldenScenario(s, sources.get(s.source), numSamples);
+            double ms = juce::Time::getMillisecondCounterHiRes() - start;
+            totalMs += ms; ++count;
+
+            bool pass = true;
+            juce::String result;
+            if (record && !fullRenders) {
+                refs.entries[name] = summarise(out);
+                result = "recorded";
+            } else if (record) {
+                auto wavFile = dir.getChildFile(name + ".wav");
+                wavFile.deleteFile();
+                if (auto stream = wavFile.createOutputStream()) {
+                    std::unique_ptr<juce::AudioFormatWriter> writer(juce::WavAudioFormat().createWriterFor(stream.get(), goldenSampleRate, 2, 32, {}, 0));
+                    if (writer != nullptr) { stream.release(); writer->writeFromAudioSampleBuffer(out, 0, numSamples); }
+                }
+                result = "recorded";
+            } else if (fullRenders) {
+                std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(dir.getChildFile(name + ".wav")));
+                if (reader == nullptr || reader->lengthInSamples != numSamples || reader->numChannels != 2) {
+                    pass = false;
+                    result = "no matching reference (record with --record)";
+                } else {
+                    juce::AudioBuffer<float> ref(2, numSamples);
+                    reader->read(&ref, 0, numSamples, 0, true, true);
+                    double snr = getSnrDb(out, ref), distance = getSpectralDistanceDb(out, ref);
+                    pass = snr >= minSnr && distance <= maxDistance;
+                    result << "snr " << (std::isinf(snr) ? juce::String("inf") : juce::String(snr, 1)) << " dB  lsd " << juce::String(distance, 3) << " dB";
+                }
+            } else if (auto it = refs.entries.find(name); it != refs.entries.end()) {
+                auto [levelError, bandError] = compareSummaries(summarise(out), it->second, refs.tolerance.rangeDb);
+                pass = levelError <= refs.tolerance.levelDb && bandError <= refs.tolerance.bandDb;
+                result << "level " << juce::String(levelError, 2) << " dB  bands " << juce::String(bandError, 2) << " dB";
+            } else {
+                pass = false;
+                result = "no reference (record with --record)";
+            }
+
+            if (!pass) ++failures;
+            std::cout << juce::String(name).paddedRight(' ', 40) << (record ? " " : pass ? " ok    " : " FAIL  ")
+                      << result << "  " << juce::String(ms, 1) << " ms\n";
+        }
+
+        if (record && !fullRenders) {
+            if (!saveGoldenReferences(refFile, refs, scenarios)) juce::ConsoleApplication::fail("cannot write " + refFile.getFullPathName());
+            std::cout << "wrote " << static_cast<int>(refs.entries.size()) << " references to " << refFile.getFullPathName() << "\n";
+        }
+        std::cout << count << " scenarios, " << juce::String(totalMs, 1) << " ms rendering\n";
+        if (failures > 0) juce::ConsoleApplication::fail(juce::String(failures) + " scenario(s) differ from the reference");
+    }
+
+    //==============================================================================
+    /** Pairs of render paths that should agree, checked against each other so no recorded
+        references are needed: offline parallel vs real-time per-voice rendering, the batched
+        engine vs the per-voice path, and each compact storage format vs float. */
+    void runEquivalence(const juce::ArgumentList& args)
+    {
+        pinFftBackend(args);
+        const int numSamples = static_cast<int>(getDoubleOption(args, "--seconds", 2.0) * goldenSampleRate);
+        GoldenSources sources;
+        auto make = [](const char* source, const char* mode) { GoldenScenario s; s.source = source; s.mode = mode; return s; };
+
+        struct Check { juce::String description; GoldenScenario a, b; double minSnr, maxLsd; };
+        std::vector<Check> checks;
+        {
+            auto offline = make("chord", "midi"), realtime = make("chord", "midi");
+            offline.offline = true; realtime.batching = false;
+            checks.push_back({ "offline parallel = real-time per-voice", offline, realtime, 90.0, 0.1 });
+        }
+        // The batched engine's fast atan2 / sincos drift slightly from the per-voice path; a lane
+        // whose phase state is lost reads as uncorrelated noise (SNR near 0 dB), far below this bound.
+        // Staggered notes keep the voices' frames on different samples, so most lanes sit idle.
+        for (int spacing : { 0, 777 }) {
+            auto batched = make("chord", "midi"), perVoice = make("chord", "midi");
+            batched.noteSpacing = perVoice.noteSpacing = spacing;
+            perVoice.batching = false;
+            checks.push_back({ spacing == 0 ? "batched ~ per-voice" : "batched ~ per-voice, staggered notes", batched, perVoice, 30.0, 1.0 });
+        }
+        {
+            // Without True Stereo the voices read the downmix, which is exactly what mono float stores
+            auto mono = make("stereo", "play");
+            mono.storage = SampleStorage::MonoFloat32;
+            checks.push_back({ "mono float = float downmix", mono, make("stereo", "play"), 90.0, 0.1 });
+        }
+        // Broadband noise keeps quantisation noise far below the signal in every bin
+        const std::pair<SampleStorage, const char*> packedFormats[] = { { SampleStorage::Int16, "int16" }, { SampleStorage::Int24, "int24" }, { SampleStorage::MonoInt16, "mono int16" } };
+        for (auto [storage, label] : packedFormats) {
+            auto packed = make("noise", "play");
+            packed.storage = storage;
+            checks.push_back({ juce::String(label) + " ~ float", packed, make("noise", "play"), -1000.0, 0.5 });
+        }
+
+        int failures = 0;
+        for (const auto& c : checks) {
+            auto a = renderGoldenScenario(c.a, sources.get(c.a.source), numSamples);
+            auto b = renderGoldenScenario(c.b, sources.get(c.b.source), numSamples);
+            double snr = getSnrDb(a, b), distance = getSpectralDistanceDb(a, b);
+            bool pass = snr >= c.minSnr && distance <= c.maxLsd;
+            if (!pass) ++failures;
+            std::cout << c.description.paddedRight(' ', 40) << (pass ? " ok    " : " FAIL  ")
+                      << "snr " << (std::isinf(snr) ? juce::String("inf") : juce::String(snr, 1)) << " dB  lsd " << juce::String(distance, 3) << " dB\n";
+        }
+        if (failures > 0) juce::ConsoleApplication::fail(juce::String(failures) + " render path(s) disagree");
+    }
+
+    //==============================================================================
+    /** Live input with no file loaded: a sine fed through the input must come out of the
+        vocoder. Fails if the output after the first frame is silent. */
+    void runLiveInput(const juce::ArgumentList& args)
+    {
+        const int numSamples = static_cast<int>(getDoubleOption(args, "--seconds", 2.0) * goldenSampleRate);
+        juce::AudioBuffer<float> input(2, numSamples);
+        for (int i = 0; i < numSamples; ++i) {
+            auto value = 0.5f * static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * 440.0 * i / goldenSampleRate));
+            input.setSample(0, i, value);
+            input.setSample(1, i, value);
+        }
+
+        int failures = 0;
+        for (int sizeIndex : { 0, 2, 4 }) {
+            GrainfreezeAudioProcessor p;
+            setParameter(p, "liveInput", 1.0f);
+            setParameter(p, "fftSize", static_cast<float>(sizeIndex));
+            p.setRandomSeed(goldenSeed);
+            jassert(!p.isAudioLoaded());
+
+            auto start = juce::Time::getMillisecondCounterHiRes();
+            auto out = renderBlocks(p, "live", numSamples, {}, &input);
+            double ms = juce::Time::getMillisecondCounterHiRes() - start;
+
+            int settled = juce::jmin(numSamples - 1, 2 * GrainfreezeAudioProcessor::getFftSizeForIndex(sizeIndex));
+            double rms = juce::jmax(out.getRMSLevel(0, settled, numSamples - settled), out.getRMSLevel(1, settled, numSamples - settled));
+            bool pass = rms > 0.01;
+            if (!pass) ++failures;
+            std::cout << "live fft" << juce::String(GrainfreezeAudioProcessor::getFftSizeForIndex(sizeIndex)).paddedRight(' ', 6)
+                      << (pass ? " ok    " : " FAIL  ") << "level " << juce::String(juce::Decibels::gainToDecibels(rms, -100.0), 1)
+                      << " dBFS  " << juce::String(ms, 1) << " ms\n";
+        }
+        if (failures > 0) juce::ConsoleApplication::fail(juce::String(failures) + " live render(s) were silent");
+    }
+
+    //==============================================================================
+    /** Cost of True Stereo against the mono path (which vocodes the downmix) on a stereo source,
+        in play and freeze mode. Vocoding each channel with its own mono vocoder would cost about
+        twice the mono time, which is the reference the packed stereo FFT is meant to beat. */
+    void runTrueStereo(const juce::ArgumentList& args)
+    {
+        const int numSamples = static_cast<int>(getDoubleOption(args, "--seconds", 4.0) * goldenSampleRate);
+        const int runs = juce::jmax(1, getIntOption(args, "--runs", 3));
+        auto sourceDir = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("grainfreeze-golden-sources");
+        sourceDir.createDirectory();
+        auto sourceFile = writeGoldenSource(sourceDir, "stereo");
+
+        auto render = [&](const juce::String& mode, int sizeIndex, bool trueStereo) {
+            double best = std::numeric_limits<double>::max();
+            for (int run = 0; run < runs; ++run) {
+                GrainfreezeAudioProcessor p;
+                setParameter(p, "fftSize", static_cast<float>(sizeIndex));
+                setParameter(p, "freezeMode", mode == "freeze" ? 1.0f : 0.0f);
+                setParameter(p, "trueStereo", trueStereo ? 1.0f : 0.0f);
+                p.setRandomSeed(goldenSeed);
+                p.loadAudioFile(sourceFile);
+                auto start = juce::Time::getMillisecondCounterHiRes();
+                renderBlocks(p, mode, numSamples);
+                best = juce::jmin(best, juce::Time::getMillisecondCounterHiRes() - start);
+            }
+            return best;
+        };
+
+        std::cout << "best of " << runs << " renders; ratio is True Stereo / mono (2.00x = two mono vocoders)\n";
+        for (auto mode : { "play", "freeze" })
+            for (int sizeIndex : { 2, 4, 6 }) {
+                double mono = render(mode, sizeIndex, false), stereo = render(mode, sizeIndex, true);
+                std::cout << juce::String(mode).paddedRight(' ', 7) << "fft" << juce::String(GrainfreezeAudioProcessor::getFftSizeForIndex(sizeIndex)).paddedRight(' ', 6)
+                          << "  mono " << juce::String(mono, 1).paddedLeft(' ', 7) << " ms  true stereo " << juce::String(stereo, 1).paddedLeft(' ', 7)
+                          << " ms  " << juce::String(stereo / juce::jmax(0.001, mono), 2) << "x\n";
+            }
+    }
+
+    //==============================================================================
+    /** Plain vs phase-locked vocoding of a steady chord, stretched 2x and frozen. A steady
+        source stretched or frozen should still be itself, so the source is the reference:
+        quality is the level-matched log-spectral distance to it, cost is the render time. */
+    void runPhaseLock(const juce::ArgumentList& args)
+    {
+        const int numSamples = static_cast<int>(getDoubleOption(args, "--seconds", 4.0) * goldenSampleRate);
+        const int skip = static_cast<int>(0.5 * goldenSampleRate);   // let the overlap-add settle
+        auto sourceDir = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("grainfreeze-golden-sources");
+        sourceDir.createDirectory();
+        auto sourceFile = writeGoldenSource(sourceDir, "chord");
+
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(sourceFile));
+        if (reader == nullptr) { juce::ConsoleApplication::fail("cannot read " + sourceFile.getFullPathName()); return; }
+        const int compareLength = juce::jmin(numSamples - skip, static_cast<int>(reader->lengthInSamples));
+        juce::AudioBuffer<float> ref(1, compareLength);
+        reader->read(&ref, 0, compareLength, 0, true, false);
+
+        struct Result { double lsd, levelDb, ms; };
+        auto render = [&](const juce::String& mode, int sizeIndex, float hopDivisor, bool locked) {
+            GrainfreezeAudioProcessor p;
+            setParameter(p, "fftSize", static_cast<float>(sizeIndex));
+            setParameter(p, "hopSize", hopDivisor);
+            setParameter(p, "phaseLock", locked ? 1.0f : 0.0f);
+            setParameter(p, "freezeMode", mode == "freeze" ? 1.0f : 0.0f);
+            setParameter(p, "timeStretch", 2.0f);
+            setParameter(p, "playheadPos", 0.3f);
+            setParameter(p, "hfBoost", 0.0f);
+            p.setRandomSeed(goldenSeed);
+            p.loadAudioFile(sourceFile);
+
+            auto start = juce::Time::getMillisecondCounterHiRes();
+            auto rendered = renderBlocks(p, mode, numSamples);
+            double ms = juce::Time::getMillisecondCounterHiRes() - start;
+
+            juce::AudioBuffer<float> out(1, compareLength);
+            out.copyFrom(0, 0, rendered, 0, skip, compareLength);
+            double outRms = out.getRMSLevel(0, 0, compareLength), refRms = ref.getRMSLevel(0, 0, compareLength);
+            if (outRms > 0.0) out.applyGain(static_cast<float>(refRms / outRms));
+            return Result{ getSpectralDistanceDb(out, ref), juce::Decibels::gainToDecibels(outRms / refRms, -100.0), ms };
+        };
+
+        for (auto mode : { "play", "freeze" }) {
+            const auto target = render(mode, 5, 4.0f, false);   // plain 16384 at 4x overlap, the usual setting
+            std::cout << mode << " (target: plain fft16384 hop/4, lsd " << juce::String(target.lsd, 2) << " dB)\n";
+            for (bool locked : { false, true })
+                for (int sizeIndex = 3; sizeIndex <= 6; ++sizeIndex)
+                    for (float hopDivisor : { 4.0f, 2.0f }) {
+                        auto r = render(mode, sizeIndex, hopDivisor, locked);
+                        std::cout << "  " << (locked ? "locked" : "plain ") << "  fft" << juce::String(GrainfreezeAudioProcessor::getFftSizeForIndex(sizeIndex)).paddedRight(' ', 6)
+                                  << " hop/" << juce::roundToInt(hopDivisor) << "  lsd " << juce::String(r.lsd, 2) << " dB  level "
+                                  << juce::String(r.levelDb, 1) << " dB  " << juce::String(r.ms, 1) << " ms  "
+                                  << juce::String(target.ms / juce::jmax(0.001, r.ms), 2) << "x"
+                                  << (r.lsd <= target.lsd ? "  <= target" : "") << "\n";
+                    }
+        }
+    }
+
+    //==============================================================================
+    /** MIDI-mode render cost against voice count, batched engine vs per-voice path. Chords start
+        all notes on one sample; staggered notes start 37 samples apart, so their frames never align. */
+    void runPolyphony(const juce::ArgumentList& args)
+    {
+        const int numSamples = static_cast<int>(getDoubleOption(args, "--seconds", 4.0) * goldenSampleRate);
+        auto sourceDir = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("grainfreeze-golden-sources");
+        sourceDir.createDirectory();
+        auto sourceFile = writeGoldenSource(sourceDir, "chord");
+
+        auto render = [&](int numVoices, bool batched, int spacing) {
+            GrainfreezeAudioProcessor p;
+            setParameter(p, "midiMode", 1.0f);
+            p.synth.setBatchingEnabled(batched);
+            p.setRandomSeed(goldenSeed);
+            p.loadAudioFile(sourceFile);
+            juce::MidiBuffer notes;
+            for (int i = 0; i < numVoices; ++i) notes.addEvent(juce::MidiMessage::noteOn(1, 36 + 3 * i, 0.8f), i * spacing);
+
+            auto start = juce::Time::getMillisecondCounterHiRes();
+            renderBlocks(p, "midi", numSamples, notes);
+            return juce::Time::getMillisecondCounterHiRes() - start;
+        };
+
+        for (int spacing : { 0, 37 }) {
+            std::cout << (spacing == 0 ? "chord" : "staggered") << " (ms per render, and relative to one voice)\n";
+            double single[2] = {};
+            for (int numVoices : { 1, 2, 4, 8, 16 }) {
+                std::cout << "  " << juce::String(numVoices).paddedLeft(' ', 2) << " voices";
+                for (bool batched : { false, true }) {
+                    double ms = render(numVoices, batched, spacing);
+                    if (numVoices == 1) single[batched ? 1 : 0] = ms;
+                    std::cout << "  " << (batched ? "batched " : "per-voice ") << juce::String(ms, 1).paddedLeft(' ', 8) << " ms ("
+                              << juce::String(ms / juce::jmax(0.001, single[batched ? 1 : 0]), 2) << "x)";
+                }
+                std::cout << "\n";
+            }
+        }
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand("--help|-h", "Usage: GrainfreezeBench <case> [options]", true);
+    app.addCommand({ "instantiate", "instantiate [--instances=N]",
+                     "Time and memory to construct and prepare N plugin instances (default 32).", {},
+                     runInstantiation });
+    app.addCommand({ "golden", "golden [--record] [--references=file] [--filter=text] [--level-tol=dB] [--band-tol=dB] [--seconds=s] [--fft=radix] "
+                               "[--dir=path [--min-snr=dB] [--max-lsd=dB]]",
+                     "Render deterministic scenarios (sine/noise/chirp x play/freeze/midi x every FFT size and window, plus other overlaps, "
+                     "phase lock, True Stereo, compact storage and offline rendering) and compare per-channel level and band levels with "
+                     "the references in bench/golden/references.txt, or record them with --record. With --dir, whole renders are recorded "
+                     "and compared instead (default thresholds: 40 dB SNR, 1 dB LSD). Fails if no references exist.", {},
+                     runGolden });
+    app.addCommand({ "equivalence", "equivalence [--seconds=s] [--fft=radix]",
+                     "Check render paths that should agree against each other: offline parallel vs real-time, batched vs per-voice, "
+                     "and compact sample storage vs float.", {},
+                     runEquivalence });
+    app.addCommand({ "live", "live [--seconds=s]",
+                     "Render a sine through live input with no file loaded and fail if the output is silent.", {},
+                     runLiveInput });
+    app.addCommand({ "stereo", "stereo [--seconds=s] [--runs=N]",
+                     "Render time of True Stereo against the mono downmix path on a stereo source, in play and freeze mode "
+                     "(a ratio of 2x is what two mono vocoders would cost).", {},
+                     runTrueStereo });
+    app.addCommand({ "phaselock", "phaselock [--seconds=s]",
+                     "Compare plain and phase-locked vocoding of a steady chord (stretched 2x and frozen) across FFT sizes and "
+                     "overlaps: spectral distance to the source, output level and render time relative to plain 16384 at hop/4.", {},
+                     runPhaseLock });
+    app.addCommand({ "polyphony", "polyphony [--seconds=s]",
+                     "MIDI-mode render time for 1-16 voices (chords and staggered notes), batched engine vs per-voice path.", {},
+                     runPolyphony });
+
+    int result = app.findAndRunCommand(argc, argv);
+   #if GRAINFREEZE_RT_CHECK
+    auto violations = RealtimeCheck::getNumViolations();
+    std::cout << "\nReal-time safety violations: " << violations << "\n" << RealtimeCheck::getReport();
+    if (violations > 0 && result == 0) result = 1;
+   #endif
+    return result;
+}